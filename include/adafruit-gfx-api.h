@@ -46,13 +46,143 @@ All text above, and the splash screen must be included in any redistribution
 #include <zephyr.h>
 #include "adafruit-gfx-defines.h"
 #include "adafruit-gfx-font.h"
+#include "adafruit-gfx-image.h"
 
+struct adafruit_gfx_cache_t;
+
+// adafruit_gfx_drawString() flags.  Horizontal and vertical alignment place
+// the string's bounding box relative to the (x, y) anchor; the defaults
+// treat (x, y) as the text cursor, like write() does.
+#define GFX_ALIGN_LEFT        0x00
+#define GFX_ALIGN_CENTER      0x01
+#define GFX_ALIGN_RIGHT       0x02
+#define GFX_ALIGN_HMASK       0x03
+#define GFX_ALIGN_BASELINE    0x00
+#define GFX_ALIGN_TOP         0x04
+#define GFX_ALIGN_MIDDLE      0x08
+#define GFX_ALIGN_BOTTOM      0x0C
+#define GFX_ALIGN_VMASK       0x0C
+#define GFX_STRING_FILL_BOX   0x10  // fill the bounding box with the text bg color
+#define GFX_STRING_MEASURE    0x20  // only compute the bounding box, draw nothing
+
+// Layers, see adafruit_gfx_setLayer().  Layer 0 is the base draw buffer,
+// CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT more are stacked on top of it.
+#define GFX_LAYER_BASE        0
+#define GFX_LAYER_OR          0     // set pixels light up what is below
+#define GFX_LAYER_XOR         1     // set pixels toggle what is below
+#define GFX_LAYER_MASK        2     // set pixels blank what is below
+
+struct adafruit_gfx_frame_stats_t {
+  uint32_t requests;    // display requests received
+  uint32_t coalesced;   // requests merged into an already pending frame
+  uint32_t frames;      // frames sent
+  uint32_t errors;      // frames that failed to send, each is retried
+  uint32_t fps_x100;    // achieved frame rate over the last second, x100
+};
+
+struct adafruit_gfx_bus_stats_t {
+  uint32_t transactions;  // bus transactions (command and data)
+  uint32_t command_bytes;
+  uint32_t data_bytes;
+  uint32_t frames;        // full frames sent by adafruit_gfx_display()
+};
+
+// External RAM cache counters, all 0 unless the cache works in lines
+struct adafruit_gfx_cache_stats_t {
+  uint32_t hits;          // accesses served by a resident line
+  uint32_t misses;        // lines read from the RAM device
+  uint32_t writebacks;    // dirty lines written back
+  uint32_t switches;      // changes of the source being drawn on or read
+};
+
+// Glyph cache counters for fonts on an external device
+struct adafruit_gfx_font_cache_stats_t {
+  uint32_t hits;
+  uint32_t misses;        // glyphs read from the device
+  uint32_t evictions;     // cached glyphs dropped to make room
+  uint32_t too_big;       // glyphs left blank, bitmap larger than a cache slot
+  uint32_t errors;        // failed device reads
+};
+
+// Counters for the arena of glyphs and images rotated on the device
+struct adafruit_gfx_arena_stats_t {
+  uint32_t hits;
+  uint32_t renders;       // assets rotated into the arena
+  uint32_t resets;        // times the arena filled up and started over
+  uint32_t too_big;       // assets larger than the whole arena
+  uint32_t used;          // bytes in use
+};
+
+// Latency histograms, see adafruit_gfx_latency()
+enum {
+  GFX_LATENCY_DISPLAY,      // adafruit_gfx_display()
+  GFX_LATENCY_BUS,          // one transfer to the panel
+  GFX_LATENCY_CACHE_MISS,   // loading a line, including writing back a dirty one
+  GFX_LATENCY_LINE,         // primitives, with CONFIG_ADAFRUIT_SSD1306_LATENCY_PRIMITIVES
+  GFX_LATENCY_RECT,
+  GFX_LATENCY_CIRCLE,
+  GFX_LATENCY_TRIANGLE,
+  GFX_LATENCY_BITMAP,
+  GFX_LATENCY_TEXT,
+  GFX_LATENCY_COUNT,
+};
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_LATENCY
+struct adafruit_gfx_latency_t {
+  uint32_t count;
+  uint32_t total_us;
+  uint32_t max_us;
+  // buckets[0] is under 1us, buckets[n] is 2^(n-1) to 2^n - 1 us, the last
+  // one also holds everything longer
+  uint32_t buckets[CONFIG_ADAFRUIT_SSD1306_LATENCY_BUCKETS];
+};
+#endif
+
+// A saved rectangle of a draw buffer, see adafruit_gfx_saveRegion()
+struct adafruit_gfx_region_t {
+  uint8_t *data;
+  void *source;         // buffer the region was saved from
+  int16_t col;          // RAM columns
+  int16_t cols;
+  uint8_t page;         // first RAM page, following pages wrap around
+  uint8_t pages;
+  bool pooled;          // data came from the region pool
+};
 
 int adafruit_gfx_initialize(void);
 void adafruit_gfx_reset(void);
 
+void adafruit_gfx_lock(void);
+void adafruit_gfx_unlock(void);
+
 void adafruit_gfx_clearDisplay(void);
+int adafruit_gfx_invertDisplay(bool invert);
+bool adafruit_gfx_isInverted(void);
+
+int adafruit_gfx_setLayer(int layer);
+int adafruit_gfx_getLayer(void);
+int adafruit_gfx_showLayer(int layer, bool visible);
+int adafruit_gfx_setLayerMode(int layer, int mode);
 int adafruit_gfx_display();
+int adafruit_gfx_displayRegion(int x, int y, int w, int h);
+void adafruit_gfx_bus_stats(struct adafruit_gfx_bus_stats_t *stats, bool reset);
+void adafruit_gfx_cache_stats(struct adafruit_gfx_cache_stats_t *stats, bool reset);
+struct adafruit_gfx_cache_t *adafruit_gfx_getCache(void);
+#ifdef CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL
+void adafruit_gfx_font_cache_stats(struct adafruit_gfx_font_cache_stats_t *stats, bool reset);
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+void adafruit_gfx_arena_stats(struct adafruit_gfx_arena_stats_t *stats, bool reset);
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_LATENCY
+void adafruit_gfx_latency(int category, struct adafruit_gfx_latency_t *hist, bool reset);
+uint32_t adafruit_gfx_latency_percentile(const struct adafruit_gfx_latency_t *hist, int percent);
+void adafruit_gfx_trace_latency(int category, uint32_t us);
+#endif
+
+int adafruit_gfx_request_display(void);
+int adafruit_gfx_request_displayRegion(int x, int y, int w, int h);
+void adafruit_gfx_frame_stats(struct adafruit_gfx_frame_stats_t *stats, bool reset);
 
 int adafruit_gfx_startScrollRight(uint8_t start, uint8_t stop);
 int adafruit_gfx_startScrollLeft(uint8_t start, uint8_t stop);
@@ -61,6 +191,18 @@ int adafruit_gfx_startScrollDiagRight(uint8_t start, uint8_t stop);
 int adafruit_gfx_startScrollDiagLeft(uint8_t start, uint8_t stop);
 int adafruit_gfx_stopScroll(void);
 
+int adafruit_gfx_scrollVertical(int lines);
+int adafruit_gfx_scrollRegion(int x, int y, int w, int h, int dy);
+int adafruit_gfx_displayRows(int y, int h);
+
+size_t adafruit_gfx_regionSize(int x, int y, int w, int h);
+int adafruit_gfx_saveRegion(struct adafruit_gfx_region_t *region, int x, int y, int w, int h,
+      uint8_t *buf, size_t len);
+int adafruit_gfx_restoreRegion(struct adafruit_gfx_region_t *region);
+int adafruit_gfx_restoreRegionRect(struct adafruit_gfx_region_t *region, int x, int y,
+      int w, int h);
+void adafruit_gfx_releaseRegion(struct adafruit_gfx_region_t *region);
+
 void adafruit_gfx_drawPixel(int x, int y, int color);
 
 void adafruit_gfx_drawFastVLine(int x, int y, int h, int color);
@@ -93,6 +235,10 @@ void adafruit_gfx_drawBitmap(int x, int y, uint8_t *bitmap,
       int w, int h, int color, int bg);
 void adafruit_gfx_drawXBitmap(int x, int y, const uint8_t *bitmap,
       int w, int h, int color);
+int adafruit_gfx_drawImage(int x, int y, const GFXimage *img);
+int adafruit_gfx_drawPages(int x, int y, int w, int h, const uint8_t *bits,
+      const uint8_t *mask);
+int adafruit_gfx_displayImage(const GFXimage *img);
 void adafruit_gfx_drawChar(int x, int y, unsigned char c, int color,
       int bg, int size);
 void adafruit_gfx_setCursor(int x, int y);
@@ -100,12 +246,20 @@ void adafruit_gfx_setTextColor(int c, int bg);
 void adafruit_gfx_setTextSize(int ts);
 void adafruit_gfx_setTextWrap(bool w);
 void adafruit_gfx_setRotation(int r);
+void adafruit_gfx_setClipRect(int x, int y, int w, int h);
+void adafruit_gfx_getClipRect(int *x, int *y, int *w, int *h);
+void adafruit_gfx_resetClip(void);
 void adafruit_gfx_cp437(bool x);
+void adafruit_gfx_utf8(bool x);
 void adafruit_gfx_setFont(const GFXfont *f);
 void adafruit_gfx_getTextBounds(char *string, int x, int y, int ts,
       int *x1, int *y1, int *w, int *h);
 
 size_t adafruit_gfx_write(uint8_t c);
+size_t adafruit_gfx_writeCodepoint(uint32_t cp);
+size_t adafruit_gfx_print(const char *str);
+int adafruit_gfx_drawString(int x, int y, const char *str, int flags,
+      int *x1, int *y1, int *w, int *h);
 
 int adafruit_gfx_height(void);
 int adafruit_gfx_width(void);
@@ -116,4 +270,9 @@ int adafruit_gfx_getRotation(void);
 int adafruit_gfx_getCursorX(void);
 int adafruit_gfx_getCursorY(void);
 
+// get the current text settings, e.g. to put them back after drawing a label
+const GFXfont *adafruit_gfx_getFont(void);
+int adafruit_gfx_getTextSize(void);
+void adafruit_gfx_getTextColor(int *c, int *bg);
+
 #endif /* __adafruit_gfx_api_h_ */
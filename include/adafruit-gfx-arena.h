@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __adafruit_gfx_arena_h_
+#define __adafruit_gfx_arena_h_
+
+#include <zephyr.h>
+#include "adafruit-gfx-api.h"
+
+/*
+ * Arena for assets rendered on the device, such as glyphs and images turned
+ * to match the buffer rotation.  Each block is tagged with its owner (the
+ * font or image), an index within the owner and the rotation.  Tags live in
+ * a direct-mapped table, so a block whose slot is taken by another tag is
+ * simply forgotten.  Once the arena is full it starts over empty.
+ *
+ * Blocks stay valid until the next adafruit_gfx_arena_alloc().  Since they
+ * are found by the owner's address, an asset rewritten in place needs an
+ * adafruit_gfx_arena_flush() before it is drawn again.
+ */
+
+uint8_t *adafruit_gfx_arena_find(const void *owner, uint32_t index, int rotation);
+uint8_t *adafruit_gfx_arena_alloc(const void *owner, uint32_t index, int rotation, size_t len);
+void adafruit_gfx_arena_flush(void);
+
+#endif /* __adafruit_gfx_arena_h_ */
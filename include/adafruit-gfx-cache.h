@@ -11,6 +11,7 @@
 #include <device.h>
 #include <devicetree.h>
 #include "adafruit-gfx-defines.h"
+#include "adafruit-gfx-api.h"
 
 
 struct adafruit_gfx_cache_source_t {
@@ -19,14 +20,30 @@ struct adafruit_gfx_cache_source_t {
   uint8_t *buffer;
 };
 
+#ifdef SSD1306_CACHE_LINES
+/* A cache line, tagged with the source it holds data for */
+struct adafruit_gfx_cache_line_t {
+  struct adafruit_gfx_cache_source_t *source;   /* NULL while unused */
+  uint8_t data[SSD1306_CACHE_LINE_SIZE] __aligned(4);
+  size_t addr;
+  bool initialized;
+  bool dirty;
+  uint32_t used;    /* when its source was last chosen */
+};
+#endif
+
 struct adafruit_gfx_cache_t {
   struct adafruit_gfx_cache_source_t *source;
-#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
-  uint8_t line[SSD1306_CACHE_LINE_SIZE];
+#ifdef SSD1306_CACHE_LINES
+  struct adafruit_gfx_cache_line_t lines[CONFIG_ADAFRUIT_SSD1306_CACHE_LINE_COUNT];
+  struct adafruit_gfx_cache_line_t *line;   /* the current source's line */
+  uint32_t clock;
+#endif
+  size_t stride;    /* bytes from one page row to the next */
+  struct adafruit_gfx_cache_stats_t stats;
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  size_t origin;    /* buffer address of the strip being rendered */
 #endif
-  bool initialized;
-  size_t line_addr;
-  bool dirty;
 };
 
 
@@ -34,9 +51,16 @@ int adafruit_gfx_cache_init(struct adafruit_gfx_cache_t *cache);
 int adafruit_gfx_cache_source_init(struct adafruit_gfx_cache_t *cache, 
         struct adafruit_gfx_cache_source_t *source, size_t start_offset, 
         const uint8_t *buf);
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_MAPPED
+uint8_t *adafruit_gfx_cache_mapping(const struct device *dev);
+#endif
 
 static inline void adafruit_gfx_cache_set_dirty(struct adafruit_gfx_cache_t *cache, bool dirty) {
-    cache->dirty = dirty;
+#ifdef SSD1306_CACHE_LINES
+    if (cache->line) {
+        cache->line->dirty = dirty;
+    }
+#endif
 }
 
 int adafruit_gfx_cache_source_choose(struct adafruit_gfx_cache_t *cache, struct adafruit_gfx_cache_source_t *source);
@@ -46,15 +70,35 @@ int adafruit_gfx_cache_load_line(struct adafruit_gfx_cache_t *cache, int x, int
 int adafruit_gfx_cache_save_line(struct adafruit_gfx_cache_t *cache, int x, int y);
 int adafruit_gfx_cache_flush_line(struct adafruit_gfx_cache_t *cache);
 int adafruit_gfx_cache_clear_all(struct adafruit_gfx_cache_t *cache);
+int adafruit_gfx_cache_fill_all(struct adafruit_gfx_cache_t *cache, uint8_t value);
 int adafruit_gfx_cache_get_pixel_addr(struct adafruit_gfx_cache_t *cache, int x, int y, uint8_t **pixel);
+int adafruit_gfx_cache_read(struct adafruit_gfx_cache_t *cache, int x, int y, uint8_t *buf, size_t len);
+int adafruit_gfx_cache_write(struct adafruit_gfx_cache_t *cache, int x, int y, const uint8_t *buf, size_t len);
+void adafruit_gfx_cache_get_stats(struct adafruit_gfx_cache_t *cache, struct adafruit_gfx_cache_stats_t *stats, bool reset);
+int adafruit_gfx_cache_get_span(struct adafruit_gfx_cache_t *cache, int x, int y, uint8_t **pixel, size_t *len);
+
+/* Buffer address of pixel (x, y).  The buffers normally share the panel's
+ * layout, but can be folded into narrower, taller page rows, or hold just
+ * the one page row starting at origin. */
+static inline size_t adafruit_gfx_cache_pixel_addr(struct adafruit_gfx_cache_t *cache, int x, int y) {
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+    return x + (y >> 3) * cache->stride - cache->origin;
+#else
+    return x + (y >> 3) * cache->stride;
+#endif
+}
 
 static inline bool adafruit_gfx_cache_is_in_line(struct adafruit_gfx_cache_t *cache, int x, int y) {
-    if (!cache->initialized) {
+#ifdef SSD1306_CACHE_LINES
+    if (!cache->line || !cache->line->initialized) {
         return false;
     }
     
-    size_t delta = SSD1306_PIXEL_ADDR(x, y) - cache->line_addr;
-    return (delta >= 0 && delta <= SSD1306_CACHE_LINE_SIZE);
+    size_t delta = adafruit_gfx_cache_pixel_addr(cache, x, y) - cache->line->addr;
+    return (delta < SSD1306_CACHE_LINE_SIZE);
+#else
+    return false;
+#endif
 }
 
 
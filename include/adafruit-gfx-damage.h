@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __adafruit_gfx_damage_h_
+#define __adafruit_gfx_damage_h_
+
+#include <zephyr.h>
+
+/*
+ * Damage lists.
+ *
+ * A fixed size array of logical screen rectangles still to be redrawn or
+ * sent, used by the scene and the sprites.  Rectangles are clipped to the
+ * screen, and ones that overlap or touch are merged, so no area is listed
+ * twice.  The caller keeps the array and its count.
+ */
+
+struct adafruit_gfx_damage_t {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+};
+
+// Add a rectangle to a list of count out of size, returns the new count
+int adafruit_gfx_damage_add(struct adafruit_gfx_damage_t *list, int count, int size,
+        int x, int y, int w, int h);
+// Drop the first n rectangles (the ones sent), returns the new count
+int adafruit_gfx_damage_drop(struct adafruit_gfx_damage_t *list, int count, int n);
+
+#endif /* __adafruit_gfx_damage_h_ */
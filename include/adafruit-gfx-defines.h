@@ -23,14 +23,23 @@
 #define SSD1306_PIXEL_ADDR(x, y) ((x) + ((y) >> 3) * SSD1306_LCDWIDTH)
 #define SSD1306_PIXEL_MASK(y)	 (1 << ((y) & 0x07))
 
-#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
+/* External RAM is worked on a line at a time unless it is memory mapped */
+#if defined(CONFIG_ADAFRUIT_SSD1306_CACHE) && !defined(CONFIG_ADAFRUIT_SSD1306_CACHE_MAPPED)
+ #define SSD1306_CACHE_LINES
  #define SSD1306_CACHE_LINE_SIZE                (CONFIG_ADAFRUIT_SSD1306_CACHE_SIZE)
 #else
  #define SSD1306_CACHE_LINE_SIZE                (SSD1306_RAM_MIRROR_SIZE)
 #endif
 
-#define SSD1306_CACHE_LINE_ADDR(x, y)           (SSD1306_PIXEL_ADDR(x, y) & (1 - SSD1306_CACHE_LINE_SIZE))
-#define SSD1306_CACHE_LINE_PIXEL_ADDR(x, y)     (SSD1306_PIXEL_ADDR(x, y) - SSD1306_CACHE_LINE_ADDR(x, y))
+#if defined(CONFIG_ADAFRUIT_SSD1306_TRANSFER_SIZE) && \
+    (CONFIG_ADAFRUIT_SSD1306_TRANSFER_SIZE < SSD1306_RAM_MIRROR_SIZE)
+ #define SSD1306_TRANSFER_SIZE                  (CONFIG_ADAFRUIT_SSD1306_TRANSFER_SIZE)
+#else
+ #define SSD1306_TRANSFER_SIZE                  (SSD1306_RAM_MIRROR_SIZE)
+#endif
+
+#define SSD1306_CACHE_LINE_ADDR(addr)           (((addr) / SSD1306_CACHE_LINE_SIZE) * SSD1306_CACHE_LINE_SIZE)
+#define SSD1306_CACHE_LINE_PIXEL_ADDR(addr)     ((addr) - SSD1306_CACHE_LINE_ADDR(addr))
 
 
 
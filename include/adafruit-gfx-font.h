@@ -21,14 +21,61 @@ typedef struct { // Data stored PER GLYPH
 	int8_t   xOffset, yOffset; // Dist from cursor pos to UL corner
 } GFXglyph;
 
+typedef struct { // Run of consecutive code points in a sparse font
+	uint32_t first;        // First code point of the run
+	uint16_t length;       // Number of code points in the run
+	uint16_t glyphIndex;   // Index into GFXfont->glyph for 'first'
+} GFXrange;
+
+// A font can keep its glyphs and bitmaps on an external flash or RAM device
+// (CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL).  The glyphs are stored as
+// GFX_GLYPH_RECORD_SIZE byte records, little endian:
+//   0  uint32_t bitmapOffset   from GFXfontStorage->bitmap_offset
+//   4  uint8_t  width, height
+//   6  uint8_t  xAdvance
+//   7  int8_t   xOffset, yOffset
+//   9  3 bytes padding
+#define GFX_GLYPH_RECORD_SIZE 12
+
+struct device;
+
+typedef struct { // Where a font on a device lives
+	const struct device *dev;
+	bool      ram;           // dev is a RAM device, else a flash device
+	uint32_t  glyph_offset;  // Glyph records, indexed like GFXfont->glyph
+	uint32_t  bitmap_offset; // Glyph bitmaps, concatenated
+} GFXfontStorage;
+
+typedef struct { // Glyphs pre-rendered as SSD1306 page bytes
+	// Variant r holds every glyph of the font turned for buffer rotation r:
+	// the glyph's bounding box as it lands in the draw buffer (width and
+	// height swapped for 1 and 3), a page row of bytes at a time, LSB on
+	// top.  Glyph i starts at bitmap[r][offset[r][i]].  Rotations without a
+	// variant fall back to the GFXfont bitmap.  Generate with
+	// scripts/gfx-font-convert.py --rotations.
+	const uint8_t  *bitmap[4];
+	const uint32_t *offset[4];
+} GFXpageFont;
+
 typedef struct { // Data stored for FONT AS A WHOLE:
 	uint8_t  *bitmap;      // Glyph bitmaps, concatenated
 	GFXglyph *fixed_glyph; // Glyph definition if fixed width
 	GFXglyph *glyph;       // Glyph array
-	uint8_t   first, last; // ASCII extents
+	uint8_t   first, last; // ASCII extents (ignored if ranges is set)
 	uint8_t   yAdvance;    // Newline distance (y axis)
+	const GFXrange *ranges; // Sparse code point index, sorted by 'first'
+	uint16_t  range_count; // Number of entries in ranges
+	const GFXfontStorage *storage; // If set, glyph and bitmap are on a device
+	const GFXpageFont *pages; // Optional page-format copy of the glyphs
 } GFXfont;
 
 extern const GFXfont adafruit_gfx_font_default;
 
+#ifdef CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL
+// Glyph cache for fonts with storage.  A returned glyph stays valid until
+// the next lookup that misses.
+GFXglyph *adafruit_gfx_font_cache_glyph(const GFXfont *font, uint32_t index);
+const uint8_t *adafruit_gfx_font_cache_bitmap(const GFXglyph *glyph);
+#endif
+
 #endif /* __adafruit_gfx_font_h_ */
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __adafruit_gfx_image_h_
+#define __adafruit_gfx_image_h_
+
+#include <zephyr.h>
+
+/*
+ * Compressed page-format image.
+ *
+ * The pixel data is laid out exactly like the SSD1306 RAM: one byte holds
+ * 8 vertical pixels (LSB on top), a page is `width` such bytes, and pages
+ * follow each other top to bottom.  That byte stream is then packed with a
+ * byte-oriented RLE so it can be decoded a few bytes at a time, straight
+ * into a cache line or onto the display bus.
+ *
+ * Stream format, repeated until `size` bytes are consumed:
+ *   0x00-0x7F  literal: the next (n + 1) bytes are copied as-is
+ *   0x80-0xFF  run:     the next byte is repeated (n - 0x80 + 2) times
+ *
+ * Use scripts/gfx-image-encode.py to generate these from PBM or raw files.
+ */
+
+#define GFX_IMAGE_LITERAL_MAX   128
+#define GFX_IMAGE_RUN_MIN       2
+#define GFX_IMAGE_RUN_MAX       129
+
+typedef struct GFXimage {
+	const uint8_t *data;   // RLE compressed page stream
+	uint16_t size;         // Length of data in bytes
+	uint16_t width;        // Width in pixels (bytes per page)
+	uint8_t  pages;        // Height in 8-pixel pages
+	// Optional copies for buffer rotations 1 to 3 ([0] is unused): the
+	// image turned the way it lands in the draw buffer, see
+	// gfx-image-encode.py --rotations
+	const struct GFXimage *rotated[4];
+} GFXimage;
+
+struct adafruit_gfx_image_decoder_t {
+  const uint8_t *src;
+  const uint8_t *end;
+  uint8_t count;      // bytes left in the current literal or run
+  uint8_t run_byte;
+  bool literal;
+};
+
+void adafruit_gfx_image_decoder_init(struct adafruit_gfx_image_decoder_t *dec,
+        const GFXimage *img);
+size_t adafruit_gfx_image_decode(struct adafruit_gfx_image_decoder_t *dec,
+        uint8_t *out, size_t len);
+size_t adafruit_gfx_image_skip(struct adafruit_gfx_image_decoder_t *dec, size_t len);
+
+#endif /* __adafruit_gfx_image_h_ */
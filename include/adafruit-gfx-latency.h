@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __adafruit_gfx_latency_h_
+#define __adafruit_gfx_latency_h_
+
+#include <zephyr.h>
+#include "adafruit-gfx-api.h"
+
+/*
+ * Latency recording for the histograms in adafruit-gfx-api.h.
+ *
+ * LATENCY_SCOPE(category) at the top of a function times it until it
+ * returns, whichever return that is.  Primitives call each other (a filled
+ * rect is a run of vertical lines), so a primitive is only recorded when no
+ * other primitive is already being timed.
+ */
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_LATENCY
+struct adafruit_gfx_latency_scope_t {
+  int category;
+  uint32_t start;
+};
+
+void adafruit_gfx_latency_enter(struct adafruit_gfx_latency_scope_t *scope);
+void adafruit_gfx_latency_exit(struct adafruit_gfx_latency_scope_t *scope);
+
+#define LATENCY_SCOPE(cat) \
+  struct adafruit_gfx_latency_scope_t _latency_scope \
+      __attribute__((cleanup(adafruit_gfx_latency_exit))) = { .category = (cat) }; \
+  adafruit_gfx_latency_enter(&_latency_scope)
+#else
+#define LATENCY_SCOPE(cat)
+#endif
+
+#if defined(CONFIG_ADAFRUIT_SSD1306_LATENCY) && defined(CONFIG_ADAFRUIT_SSD1306_LATENCY_PRIMITIVES)
+#define LATENCY_PRIMITIVE(cat) LATENCY_SCOPE(cat)
+#else
+#define LATENCY_PRIMITIVE(cat)
+#endif
+
+#endif /* __adafruit_gfx_latency_h_ */
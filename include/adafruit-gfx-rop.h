@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __adafruit_gfx_rop_h_
+#define __adafruit_gfx_rop_h_
+
+#include <zephyr.h>
+
+/*
+ * Raster operations over runs of framebuffer bytes.
+ *
+ * The buffers are in SSD1306 page format, so a run is part of a page row:
+ * consecutive columns, each byte holding 8 vertical pixels.  Everything is
+ * done a machine word at a time once the destination is aligned, with byte
+ * loops only for the unaligned head and tail.  The inner loops are plain
+ * enough for the compiler to vectorize on hosts that can.
+ */
+
+typedef enum {
+    ROP_COPY,       /* dst = src */
+    ROP_OR,         /* dst |= src */
+    ROP_AND,        /* dst &= src */
+    ROP_XOR,        /* dst ^= src */
+    ROP_ANDNOT,     /* dst &= ~src */
+} rop_t;
+
+/* Combine every byte of dst with a constant value */
+void adafruit_gfx_rop_apply(uint8_t *dst, size_t len, rop_t rop, uint8_t value);
+
+/* Combine dst with src byte by byte, the buffers must not overlap */
+void adafruit_gfx_rop_compose(uint8_t *dst, const uint8_t *src, size_t len, rop_t rop);
+
+/* dst = (dst & ~mask) | (src & mask) for every byte */
+void adafruit_gfx_rop_blend(uint8_t *dst, const uint8_t *src, size_t len, uint8_t mask);
+
+/*
+ * Move the pixels of a page row up (towards bit 0) or down by n (1-7) rows.
+ * The rows shifted in come from the neighbouring page row, 'below' for up
+ * and 'above' for down, or are cleared if that is NULL.
+ */
+void adafruit_gfx_rop_shift_up(uint8_t *dst, const uint8_t *below, size_t len, int n);
+void adafruit_gfx_rop_shift_down(uint8_t *dst, const uint8_t *above, size_t len, int n);
+
+/*
+ * Transpose an 8x8 bit tile: bit j of out[i] is bit i of in[j].  Turns 8
+ * columns of a page into 8 rows of page bytes, for rotating by 90 degrees.
+ */
+void adafruit_gfx_rop_transpose8(const uint8_t *in, uint8_t *out);
+
+static inline void adafruit_gfx_rop_fill(uint8_t *dst, size_t len, uint8_t value) {
+    adafruit_gfx_rop_apply(dst, len, ROP_COPY, value);
+}
+
+static inline void adafruit_gfx_rop_invert(uint8_t *dst, size_t len) {
+    adafruit_gfx_rop_apply(dst, len, ROP_XOR, 0xFF);
+}
+
+static inline void adafruit_gfx_rop_copy(uint8_t *dst, const uint8_t *src, size_t len) {
+    adafruit_gfx_rop_compose(dst, src, len, ROP_COPY);
+}
+
+#endif /* __adafruit_gfx_rop_h_ */
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __adafruit_gfx_scene_h_
+#define __adafruit_gfx_scene_h_
+
+#include <zephyr.h>
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-damage.h"
+
+/*
+ * Retained scene.
+ *
+ * A scene is a list of objects drawn in order over a background color.
+ * The objects belong to the caller and keep their properties from frame to
+ * frame.  Changing a property through the setters below marks the object's
+ * old and new bounds as damaged, and adafruit_gfx_scene_update() redraws
+ * only the damaged rectangles (the background plus every object overlapping
+ * them, clipped to the rectangle) and sends just those to the panel.
+ *
+ * Drawing goes through the immediate-mode adafruit_gfx_* calls.  The clip
+ * and the text font, size and colors are put back as they were after an
+ * update, and after a label is measured.
+ */
+
+enum {
+  GFX_OBJ_RECT,
+  GFX_OBJ_LINE,
+  GFX_OBJ_LABEL,
+  GFX_OBJ_BITMAP,
+};
+
+struct adafruit_gfx_scene_t;
+
+struct adafruit_gfx_obj_t {
+  struct adafruit_gfx_obj_t *next;
+  struct adafruit_gfx_scene_t *scene;	// NULL until added to a scene
+  uint8_t type;
+  bool visible;
+  int16_t x;
+  int16_t y;
+  int16_t w;	// rects and bitmaps
+  int16_t h;
+  int color;
+  int bg;
+  union {
+    struct {
+      int16_t radius;
+      bool fill;
+    } rect;
+    struct {
+      int16_t x1;	// far end
+      int16_t y1;
+    } line;
+    struct {
+      const char *text;	// caller owned, must stay valid
+      const GFXfont *font;
+      uint8_t size;
+      uint8_t flags;	// adafruit_gfx_drawString() flags
+    } label;
+    struct {
+      const uint8_t *data;
+    } bitmap;
+  };
+  int16_t bx;	// bounds as last drawn, bw == 0 if nothing
+  int16_t by;
+  int16_t bw;
+  int16_t bh;
+};
+
+struct adafruit_gfx_scene_t {
+  struct adafruit_gfx_obj_t *objs;	// in drawing order
+  int bg;
+  uint8_t damage_count;
+  struct adafruit_gfx_damage_t damage[CONFIG_ADAFRUIT_SSD1306_SCENE_DAMAGE_RECTS];
+};
+
+void adafruit_gfx_scene_init(struct adafruit_gfx_scene_t *scene, int bg);
+void adafruit_gfx_scene_add(struct adafruit_gfx_scene_t *scene, struct adafruit_gfx_obj_t *obj);
+void adafruit_gfx_scene_remove(struct adafruit_gfx_obj_t *obj);
+void adafruit_gfx_scene_invalidate(struct adafruit_gfx_scene_t *scene, int x, int y, int w, int h);
+int adafruit_gfx_scene_update(struct adafruit_gfx_scene_t *scene);
+
+void adafruit_gfx_rect_init(struct adafruit_gfx_obj_t *obj, int x, int y, int w, int h,
+        int radius, bool fill, int color);
+void adafruit_gfx_line_init(struct adafruit_gfx_obj_t *obj, int x0, int y0, int x1, int y1,
+        int color);
+void adafruit_gfx_label_init(struct adafruit_gfx_obj_t *obj, int x, int y, const char *text,
+        const GFXfont *font, int size, int flags, int color, int bg);
+void adafruit_gfx_bitmap_init(struct adafruit_gfx_obj_t *obj, int x, int y,
+        const uint8_t *data, int w, int h, int color, int bg);
+
+void adafruit_gfx_obj_set_pos(struct adafruit_gfx_obj_t *obj, int x, int y);
+void adafruit_gfx_obj_set_size(struct adafruit_gfx_obj_t *obj, int w, int h);
+void adafruit_gfx_obj_set_color(struct adafruit_gfx_obj_t *obj, int color, int bg);
+void adafruit_gfx_obj_set_visible(struct adafruit_gfx_obj_t *obj, bool visible);
+void adafruit_gfx_line_set_end(struct adafruit_gfx_obj_t *obj, int x1, int y1);
+void adafruit_gfx_label_set_text(struct adafruit_gfx_obj_t *obj, const char *text);
+void adafruit_gfx_bitmap_set_data(struct adafruit_gfx_obj_t *obj, const uint8_t *data);
+
+#endif /* __adafruit_gfx_scene_h_ */
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __adafruit_gfx_sprite_h_
+#define __adafruit_gfx_sprite_h_
+
+#include <zephyr.h>
+#include "adafruit-gfx-api.h"
+
+/*
+ * Sprites.
+ *
+ * Small page-format images (see adafruit_gfx_drawPages()) moved over
+ * whatever is drawn below them, such as a cursor or a spinner.  The sprites
+ * belong to the caller.  The setters only note the change;
+ * adafruit_gfx_sprites_commit() takes the changed sprites (and the ones
+ * above that overlap them) off the draw buffer, top first, puts them back
+ * at their new positions, bottom first, and sends the rectangles that
+ * changed to the panel.
+ *
+ * A masked sprite saves the background under it while it is shown and puts
+ * it back when taken off, an XOR sprite toggles the background twice.
+ * Either way the background under a shown sprite must not be redrawn
+ * between commits, and the rotation must not change while sprites are
+ * shown.  Sprites are drawn into the current layer.
+ *
+ * With CONFIG_ADAFRUIT_SSD1306_ARENA the copies of the bits turned for the
+ * display rotation are found by address: after rewriting bits or a mask in
+ * place, call adafruit_gfx_arena_flush().
+ */
+
+enum {
+  GFX_SPRITE_MASK,	// set bits WHITE, clear bits BLACK where the mask is set
+  GFX_SPRITE_XOR,	// set bits toggle the background
+};
+
+// Background save buffer large enough for a w x h masked sprite anywhere
+#define GFX_SPRITE_SAVE_SIZE(w, h) \
+  MAX((w) * (((h) + 7) / 8 + 1), (h) * (((w) + 7) / 8 + 1))
+
+struct adafruit_gfx_sprite_t {
+  struct adafruit_gfx_sprite_t *next;	// in drawing order
+  struct adafruit_gfx_sprite_t *prev;
+  const uint8_t *bits;	// w bytes per page, caller owned
+  const uint8_t *mask;	// same layout, required for GFX_SPRITE_MASK
+  uint8_t mode;
+  bool visible;
+  bool changed;		// since the last commit
+  bool added;		// registered with adafruit_gfx_sprite_add()
+  bool removed;		// taken off and unlinked by the next commit
+  bool redraw;		// taken off and put back by the current commit
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+  uint8_t *buf;		// background save buffer, NULL for the region pool
+  size_t len;
+  // As last drawn
+  bool drawn;
+  int16_t dx;
+  int16_t dy;
+  const uint8_t *dbits;
+  struct adafruit_gfx_region_t save;
+};
+
+void adafruit_gfx_sprite_init(struct adafruit_gfx_sprite_t *sprite, int mode, const uint8_t *bits,
+        const uint8_t *mask, int w, int h, uint8_t *buf, size_t len);
+void adafruit_gfx_sprite_add(struct adafruit_gfx_sprite_t *sprite);
+void adafruit_gfx_sprite_remove(struct adafruit_gfx_sprite_t *sprite);
+void adafruit_gfx_sprite_set_pos(struct adafruit_gfx_sprite_t *sprite, int x, int y);
+void adafruit_gfx_sprite_set_visible(struct adafruit_gfx_sprite_t *sprite, bool visible);
+void adafruit_gfx_sprite_set_image(struct adafruit_gfx_sprite_t *sprite, const uint8_t *bits,
+        const uint8_t *mask);
+int adafruit_gfx_sprites_commit(void);
+
+#endif /* __adafruit_gfx_sprite_h_ */
@@ -0,0 +1,407 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2020 Gavin Hurlbut
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Convert a BDF, PCF, TTF or OTF font into a GFXfont.
+
+BDF files are read directly.  Everything else goes through FreeType, which
+needs the freetype-py module (pip install freetype-py); outline fonts are
+rendered at --size points and --dpi without anti-aliasing.
+
+Every glyph is trimmed to the bounding box of its set pixels.  The output is
+a C source fragment defining a `const GFXfont` that works with
+adafruit_gfx_setFont() as-is.  With --rotations it also carries a
+GFXpageFont: the same glyphs pre-rendered as SSD1306 page bytes for each of
+the given buffer rotations, which the library blits a byte at a time at text
+size 1 instead of walking the bitmap pixel by pixel.
+
+With --storage the glyph records and bitmaps are written to a binary file
+for an external flash or RAM device instead (see GFXfontStorage in
+include/adafruit-gfx-font.h), and only the font header is emitted as C.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+try:
+    import freetype
+except ImportError:
+    freetype = None
+
+GLYPH_RECORD = struct.Struct("<IBBBbb3x")
+
+
+class Glyph:
+    def __init__(self, cp, width, height, x_offset, y_offset, x_advance, rows):
+        self.cp = cp
+        self.width = width
+        self.height = height
+        self.x_offset = x_offset
+        self.y_offset = y_offset    # from the baseline to the top row
+        self.x_advance = x_advance
+        self.rows = rows            # height lists of width 0/1 pixels
+
+    def trim(self):
+        """Shrink to the bounding box of the set pixels."""
+        set_rows = [y for y, row in enumerate(self.rows) if any(row)]
+        if not set_rows:
+            self.width = self.height = 0
+            self.x_offset = self.y_offset = 0
+            self.rows = []
+            return
+
+        cols = [x for x in range(self.width) if any(row[x] for row in self.rows)]
+        top, bottom = set_rows[0], set_rows[-1] + 1
+        left, right = cols[0], cols[-1] + 1
+        self.rows = [row[left:right] for row in self.rows[top:bottom]]
+        self.x_offset += left
+        self.y_offset += top
+        self.width = right - left
+        self.height = bottom - top
+
+    def rotated(self, rotation):
+        """Pixels as they land in a draw buffer turned by rotation * 90
+        degrees, the inverse of the library's logical to buffer mapping."""
+        w, h, rows = self.width, self.height, self.rows
+        if rotation == 0:
+            return w, h, rows
+        if rotation == 1:
+            return h, w, [[rows[h - 1 - u][v] for u in range(h)] for v in range(w)]
+        if rotation == 2:
+            return w, h, [[rows[h - 1 - v][w - 1 - u] for u in range(w)] for v in range(h)]
+        return h, w, [[rows[u][w - 1 - v] for u in range(h)] for v in range(w)]
+
+
+def bits_to_rows(data, width, height, pitch):
+    return [[(data[y * pitch + (x >> 3)] >> (7 - (x & 7))) & 1 for x in range(width)]
+            for y in range(height)]
+
+
+def read_bdf(path, codepoints):
+    """Parse a BDF file directly, returns (glyphs by code point, yAdvance)."""
+    glyphs = {}
+    props = {}
+    font_bbox = None
+    cur = None
+    in_bitmap = False
+    hexrows = []
+
+    with open(path, encoding="latin-1") as f:
+        for line in f:
+            words = line.split()
+            if not words:
+                continue
+            key = words[0]
+
+            if in_bitmap:
+                if key == "ENDCHAR":
+                    in_bitmap = False
+                    if cur["cp"] in codepoints:
+                        w, h, xo, yo = cur["bbx"]
+                        pitch = (w + 7) // 8
+                        data = bytearray()
+                        for row in hexrows:
+                            data.extend(bytes.fromhex(row.ljust(pitch * 2, "0")[:pitch * 2]))
+                        glyphs[cur["cp"]] = Glyph(cur["cp"], w, h, xo, 1 - (yo + h),
+                                                  cur["dwidth"],
+                                                  bits_to_rows(data, w, h, pitch))
+                    cur = None
+                else:
+                    hexrows.append(key)
+                continue
+
+            if key == "FONTBOUNDINGBOX":
+                font_bbox = [int(v) for v in words[1:5]]
+            elif key in ("FONT_ASCENT", "FONT_DESCENT", "PIXEL_SIZE"):
+                props[key] = int(words[1])
+            elif key == "STARTCHAR":
+                cur = {"cp": -1, "dwidth": 0, "bbx": (0, 0, 0, 0)}
+            elif key == "ENCODING" and cur is not None:
+                cur["cp"] = int(words[1])
+            elif key == "DWIDTH" and cur is not None:
+                cur["dwidth"] = int(words[1])
+            elif key == "BBX" and cur is not None:
+                cur["bbx"] = tuple(int(v) for v in words[1:5])
+            elif key == "BITMAP" and cur is not None:
+                in_bitmap = True
+                hexrows = []
+
+    if "FONT_ASCENT" in props and "FONT_DESCENT" in props:
+        y_advance = props["FONT_ASCENT"] + props["FONT_DESCENT"]
+    elif font_bbox:
+        y_advance = font_bbox[1]
+    else:
+        y_advance = max((g.height for g in glyphs.values()), default=0)
+
+    return glyphs, y_advance
+
+
+def read_freetype(path, codepoints, size, dpi):
+    """Render through FreeType, returns (glyphs by code point, yAdvance)."""
+    if freetype is None:
+        sys.exit("%s: reading this font needs FreeType (pip install freetype-py)" % path)
+
+    face = freetype.Face(path)
+    if face.is_scalable:
+        face.set_char_size(size * 64, 0, dpi, dpi)
+    else:
+        # Bitmap font (PCF and friends), take the strike closest to --size
+        # in pixels
+        sizes = face.available_sizes
+        best = min(range(len(sizes)), key=lambda i: abs(sizes[i].height - size))
+        face.select_size(best)
+
+    flags = freetype.FT_LOAD_RENDER | freetype.FT_LOAD_TARGET_MONO
+    glyphs = {}
+    for cp in sorted(codepoints):
+        if face.get_char_index(cp) == 0:
+            continue
+        face.load_char(cp, flags)
+        slot = face.glyph
+        bitmap = slot.bitmap
+        rows = bits_to_rows(bytes(bitmap.buffer), bitmap.width, bitmap.rows, bitmap.pitch)
+        glyphs[cp] = Glyph(cp, bitmap.width, bitmap.rows, slot.bitmap_left,
+                           1 - slot.bitmap_top, slot.advance.x >> 6, rows)
+
+    return glyphs, face.size.height >> 6
+
+
+def parse_ranges(specs):
+    codepoints = set()
+    for spec in specs:
+        for part in spec.split(","):
+            lo, _, hi = part.partition("-")
+            lo = int(lo, 0)
+            hi = int(hi, 0) if hi else lo
+            if hi < lo:
+                sys.exit("bad range %s" % part)
+            codepoints.update(range(lo, hi + 1))
+    return codepoints
+
+
+def pack_rows(glyph):
+    """GFXfont bitmap: row-major bit stream, MSB first, padded to a byte."""
+    out = bytearray()
+    acc = nbits = 0
+    for row in glyph.rows:
+        for bit in row:
+            acc = (acc << 1) | bit
+            nbits += 1
+            if nbits == 8:
+                out.append(acc)
+                acc = nbits = 0
+    if nbits:
+        out.append(acc << (8 - nbits))
+    return out
+
+
+def pack_pages(width, height, rows):
+    out = bytearray()
+    for page in range((height + 7) // 8):
+        for x in range(width):
+            byte = 0
+            for bit in range(8):
+                y = page * 8 + bit
+                if y < height and rows[y][x]:
+                    byte |= 1 << bit
+            out.append(byte)
+    return out
+
+
+def index_runs(cps):
+    """Split sorted code points into (first, length, glyph index) runs."""
+    runs = []
+    for i, cp in enumerate(cps):
+        if runs and runs[-1][0] + runs[-1][1] == cp:
+            runs[-1][1] += 1
+        else:
+            runs.append([cp, 1, i])
+    return runs
+
+
+def char_comment(cp):
+    if 0x20 <= cp < 0x7F and chr(cp) not in "\\'":
+        return "0x%02X '%s'" % (cp, chr(cp))
+    return "U+%04X" % cp
+
+
+def emit_bytes(lines, decl, data):
+    lines.append("%s = {" % decl)
+    for i in range(0, len(data), 16):
+        lines.append("\t" + " ".join("0x%02X," % b for b in data[i:i + 16]))
+    lines.append("};")
+    lines.append("")
+
+
+def emit_c(name, glyphs, y_advance, first_last, runs, rotations, storage):
+    lines = []
+    lines.append("/* %d glyphs, yAdvance %d */" % (len(glyphs), y_advance))
+    lines.append("")
+
+    if storage is None:
+        bitmap = bytearray()
+        offsets = []
+        for g in glyphs:
+            offsets.append(len(bitmap))
+            bitmap.extend(pack_rows(g))
+        if len(bitmap) > 0xFFFF:
+            sys.exit("bitmap too large for GFXglyph (%d bytes), use --storage" % len(bitmap))
+
+        emit_bytes(lines, "static const uint8_t %s_bitmap[]" % name, bitmap)
+
+        lines.append("static const GFXglyph %s_glyphs[] = {" % name)
+        for g, off in zip(glyphs, offsets):
+            lines.append("\t{ %5d, %3d, %3d, %3d, %4d, %4d }, // %s"
+                         % (off, g.width, g.height, g.x_advance, g.x_offset, g.y_offset,
+                            char_comment(g.cp)))
+        lines.append("};")
+        lines.append("")
+
+        for r in rotations:
+            data = bytearray()
+            starts = []
+            for g in glyphs:
+                starts.append(len(data))
+                data.extend(pack_pages(*g.rotated(r)))
+            emit_bytes(lines, "static const uint8_t %s_pages%d[]" % (name, r), data)
+            lines.append("static const uint32_t %s_pages%d_offset[] = {" % (name, r))
+            for i in range(0, len(starts), 8):
+                lines.append("\t" + " ".join("%d," % v for v in starts[i:i + 8]))
+            lines.append("};")
+            lines.append("")
+
+        if rotations:
+            lines.append("static const GFXpageFont %s_pages = {" % name)
+            lines.append("\t.bitmap = { %s }," % ", ".join(
+                "[%d] = %s_pages%d" % (r, name, r) for r in rotations))
+            lines.append("\t.offset = { %s }," % ", ".join(
+                "[%d] = %s_pages%d_offset" % (r, name, r) for r in rotations))
+            lines.append("};")
+            lines.append("")
+    else:
+        path, base, glyph_offset, bitmap_offset = storage
+        lines.append("/* Glyphs and bitmaps are in %s, to be written at offset %d.  Set .dev"
+                     % (os.path.basename(path), base))
+        lines.append(" * (and .ram for a RAM device) before selecting the font. */")
+        lines.append("GFXfontStorage %s_storage = {" % name)
+        lines.append("\t.dev = NULL,")
+        lines.append("\t.ram = false,")
+        lines.append("\t.glyph_offset = %d," % glyph_offset)
+        lines.append("\t.bitmap_offset = %d," % bitmap_offset)
+        lines.append("};")
+        lines.append("")
+
+    if runs is not None:
+        lines.append("static const GFXrange %s_ranges[] = {" % name)
+        for first, length, index in runs:
+            lines.append("\t{ 0x%04X, %d, %d }," % (first, length, index))
+        lines.append("};")
+        lines.append("")
+
+    lines.append("const GFXfont %s = {" % name)
+    if storage is None:
+        lines.append("\t.bitmap = (uint8_t *)%s_bitmap," % name)
+        lines.append("\t.glyph = (GFXglyph *)%s_glyphs," % name)
+    if first_last is not None:
+        lines.append("\t.first = 0x%02X," % first_last[0])
+        lines.append("\t.last = 0x%02X," % first_last[1])
+    lines.append("\t.yAdvance = %d," % y_advance)
+    if runs is not None:
+        lines.append("\t.ranges = %s_ranges," % name)
+        lines.append("\t.range_count = %d," % len(runs))
+    if storage is not None:
+        lines.append("\t.storage = &%s_storage," % name)
+    elif rotations:
+        lines.append("\t.pages = &%s_pages," % name)
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def write_storage(path, glyphs):
+    """Glyph records followed by the bitmaps, returns the bitmap offset."""
+    records = bytearray()
+    bitmap = bytearray()
+    for g in glyphs:
+        records.extend(GLYPH_RECORD.pack(len(bitmap), g.width, g.height, g.x_advance,
+                                         g.x_offset, g.y_offset))
+        bitmap.extend(pack_rows(g))
+    with open(path, "wb") as f:
+        f.write(records)
+        f.write(bitmap)
+    return len(records)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="BDF, PCF, TTF or OTF font file")
+    parser.add_argument("-n", "--name", default="font",
+                        help="C identifier for the GFXfont")
+    parser.add_argument("-o", "--output", help="output file (default stdout)")
+    parser.add_argument("-s", "--size", type=int, default=12,
+                        help="point size for outline fonts, pixel height for bitmap fonts")
+    parser.add_argument("--dpi", type=int, default=141,
+                        help="resolution for outline fonts (default 141, as fontconvert)")
+    parser.add_argument("-r", "--range", action="append", dest="ranges",
+                        help="code points to include, e.g. 0x20-0x7E,0xB0 (repeatable, "
+                             "default 0x20-0x7E)")
+    parser.add_argument("--rotations", default="",
+                        help="buffer rotations to pre-render as page bytes, e.g. 0 or 0,1,2,3")
+    parser.add_argument("--storage", metavar="FILE",
+                        help="write glyphs and bitmaps to FILE for an external device")
+    parser.add_argument("--storage-offset", type=lambda v: int(v, 0), default=0,
+                        help="device offset FILE will be written at")
+    args = parser.parse_args()
+
+    codepoints = parse_ranges(args.ranges or ["0x20-0x7E"])
+    rotations = sorted({int(r) for r in args.rotations.split(",") if r.strip()})
+    if any(r not in range(4) for r in rotations):
+        parser.error("rotations are 0 to 3")
+    if rotations and args.storage:
+        parser.error("--rotations needs the glyphs in memory, not with --storage")
+
+    if re.search(r"\.bdf$", args.input, re.I):
+        found, y_advance = read_bdf(args.input, codepoints)
+    else:
+        found, y_advance = read_freetype(args.input, codepoints, args.size, args.dpi)
+    if not found:
+        sys.exit("%s: none of the requested code points are in the font" % args.input)
+
+    for g in found.values():
+        g.trim()
+        if g.width > 255 or g.height > 255 or g.x_advance > 255:
+            sys.exit("%s: glyph %s too large" % (args.input, char_comment(g.cp)))
+
+    # An 8-bit span of code points keeps the plain first/last index, with
+    # blank glyphs for any holes.  Anything else is indexed by ranges.
+    lo, hi = min(codepoints), max(codepoints)
+    if hi <= 0xFF and hi - lo + 1 <= len(found) * 2:
+        glyphs = [found.get(cp) or Glyph(cp, 0, 0, 0, 0, 0, []) for cp in range(lo, hi + 1)]
+        first_last = (lo, hi)
+        runs = None
+    else:
+        glyphs = [found[cp] for cp in sorted(found)]
+        first_last = None
+        runs = index_runs([g.cp for g in glyphs])
+
+    storage = None
+    if args.storage:
+        bitmap_offset = write_storage(args.storage, glyphs)
+        storage = (args.storage, args.storage_offset, args.storage_offset,
+                   args.storage_offset + bitmap_offset)
+
+    text = emit_c(args.name, glyphs, y_advance, first_last, runs, rotations, storage)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()
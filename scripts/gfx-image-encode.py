@@ -0,0 +1,252 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2020 Gavin Hurlbut
+#
+# SPDX-License-Identifier: Apache-2.0
+
+"""Encode a monochrome image as an RLE compressed, page-format GFXimage.
+
+Input can be a PBM file (P1 or P4), a raw file that is already in SSD1306
+page format (--raw, needs --width), or a C source file holding a page-format
+byte array such as src/adafruit-gfx-logo.c (--c-array, needs --width).
+
+The output is a C source fragment defining a `const GFXimage`.  See
+include/adafruit-gfx-image.h for the stream format.  With --rotations it
+also carries copies of the image turned for those buffer rotations, so
+adafruit_gfx_drawImage() keeps decoding straight into the draw buffer when
+the display is rotated.
+"""
+
+import argparse
+import re
+import sys
+
+LITERAL_MAX = 128
+RUN_MIN = 2
+RUN_MAX = 129
+# Runs shorter than this are cheaper to keep inside a literal
+RUN_THRESHOLD = 3
+
+
+def read_pbm(path):
+    with open(path, "rb") as f:
+        data = f.read()
+
+    # Tokenize the header, skipping comments
+    tokens = []
+    pos = 0
+    while len(tokens) < 3:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            pos = data.index(b"\n", pos) + 1
+            continue
+        start = pos
+        while not data[pos:pos + 1].isspace():
+            pos += 1
+        tokens.append(data[start:pos].decode("ascii"))
+
+    magic, width, height = tokens[0], int(tokens[1]), int(tokens[2])
+    pixels = []
+    if magic == "P4":
+        pos += 1
+        stride = (width + 7) // 8
+        for y in range(height):
+            row = data[pos + y * stride:pos + (y + 1) * stride]
+            pixels.append([(row[x >> 3] >> (7 - (x & 7))) & 1
+                           for x in range(width)])
+    elif magic == "P1":
+        bits = [int(c) for c in data[pos:].decode("ascii") if c in "01"]
+        for y in range(height):
+            pixels.append(bits[y * width:(y + 1) * width])
+    else:
+        sys.exit("%s: unsupported PBM type %s" % (path, magic))
+
+    return width, height, pixels
+
+
+def pixels_to_pages(width, height, pixels, invert=False):
+    pages = (height + 7) // 8
+    out = bytearray()
+    for page in range(pages):
+        for x in range(width):
+            byte = 0
+            for bit in range(8):
+                y = page * 8 + bit
+                if y < height and (pixels[y][x] ^ invert):
+                    byte |= 1 << bit
+            out.append(byte)
+    return out
+
+
+def read_c_array(path):
+    with open(path) as f:
+        text = f.read()
+    # Drop comments so the hex digits in them aren't picked up
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"//.*", "", text)
+    body = text[text.index("{") + 1:text.rindex("}")]
+    return bytearray(int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]{1,2}", body))
+
+
+def rotate_pages(width, pages, data, rotation):
+    """Page bytes of the image as it lands in a draw buffer turned by
+    rotation * 90 degrees, and their width."""
+    height = pages * 8
+    rw, rh = (height, width) if rotation & 1 else (width, height)
+    out = bytearray(rw * ((rh + 7) // 8))
+    for gy in range(height):
+        for gx in range(width):
+            if not (data[(gy // 8) * width + gx] >> (gy & 7)) & 1:
+                continue
+            if rotation == 1:
+                u, v = height - 1 - gy, gx
+            elif rotation == 2:
+                u, v = width - 1 - gx, height - 1 - gy
+            else:
+                u, v = gy, width - 1 - gx
+            out[(v // 8) * rw + u] |= 1 << (v & 7)
+    return rw, out
+
+
+def encode(data):
+    out = bytearray()
+    literal = bytearray()
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:LITERAL_MAX]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literal[:LITERAL_MAX]
+
+    i = 0
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and data[i + run] == data[i] and run < RUN_MAX:
+            run += 1
+
+        if run >= RUN_THRESHOLD:
+            flush_literal()
+            out.append(0x80 | (run - RUN_MIN))
+            out.append(data[i])
+            i += run
+        else:
+            literal.append(data[i])
+            i += 1
+
+    flush_literal()
+    return out
+
+
+def decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        ctrl = data[i]
+        i += 1
+        if ctrl & 0x80:
+            out.extend(bytes([data[i]]) * ((ctrl & 0x7F) + RUN_MIN))
+            i += 1
+        else:
+            out.extend(data[i:i + ctrl + 1])
+            i += ctrl + 1
+    return out
+
+
+def emit_image(name, width, pages, packed, raw_size, rotated=None, static=False):
+    lines = []
+    lines.append("/* %dx%d, %d bytes packed from %d (%.1fx) */"
+                 % (width, pages * 8, len(packed), raw_size,
+                    raw_size / max(len(packed), 1)))
+    lines.append("static const uint8_t %s_data[] = {" % name)
+    for i in range(0, len(packed), 16):
+        lines.append("\t" + " ".join("0x%02X," % b for b in packed[i:i + 16]))
+    lines.append("};")
+    lines.append("")
+    lines.append("%sconst GFXimage %s = {" % ("static " if static else "", name))
+    lines.append("\t.data = %s_data," % name)
+    lines.append("\t.size = sizeof(%s_data)," % name)
+    lines.append("\t.width = %d," % width)
+    lines.append("\t.pages = %d," % pages)
+    if rotated:
+        lines.append("\t.rotated = { %s }," % ", ".join(
+            "[%d] = &%s" % (r, n) for r, n in rotated))
+    lines.append("};")
+    return lines
+
+
+def emit_c(name, width, pages, pagedata, rotations):
+    lines = []
+    rotated = []
+    for r in rotations:
+        rw, rdata = rotate_pages(width, pages, pagedata, r)
+        rname = "%s_r%d" % (name, r)
+        lines += emit_image(rname, rw, len(rdata) // rw, check_encode(rdata), len(rdata),
+                            static=True)
+        lines.append("")
+        rotated.append((r, rname))
+
+    lines += emit_image(name, width, pages, check_encode(pagedata), len(pagedata), rotated)
+    return "\n".join(lines) + "\n"
+
+
+def check_encode(data):
+    packed = encode(data)
+    if decode(packed) != data:
+        sys.exit("internal error: encoded stream does not round-trip")
+    if len(packed) > 0xFFFF:
+        sys.exit("packed image too large (%d bytes)" % len(packed))
+    return packed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="PBM, raw page-format or C source file")
+    parser.add_argument("-n", "--name", default="image",
+                        help="C identifier for the GFXimage")
+    parser.add_argument("-o", "--output", help="output file (default stdout)")
+    parser.add_argument("--raw", action="store_true",
+                        help="input is raw page-format bytes")
+    parser.add_argument("--c-array", action="store_true",
+                        help="input is a C file with a page-format byte array")
+    parser.add_argument("--width", type=int,
+                        help="image width for --raw and --c-array input")
+    parser.add_argument("--invert", action="store_true",
+                        help="invert PBM pixels (PBM 1 = black)")
+    parser.add_argument("--rotations", default="",
+                        help="buffer rotations to add turned copies for, e.g. 1,3")
+    args = parser.parse_args()
+
+    rotations = sorted({int(r) for r in args.rotations.split(",") if r.strip()})
+    if any(r not in range(1, 4) for r in rotations):
+        parser.error("rotations are 1 to 3")
+
+    if args.raw or args.c_array:
+        if not args.width:
+            parser.error("--width is required for --raw and --c-array")
+        if args.raw:
+            with open(args.input, "rb") as f:
+                pagedata = bytearray(f.read())
+        else:
+            pagedata = read_c_array(args.input)
+        width = args.width
+        if len(pagedata) % width:
+            sys.exit("%s: %d bytes is not a whole number of %d byte pages"
+                     % (args.input, len(pagedata), width))
+    else:
+        width, height, pixels = read_pbm(args.input)
+        pagedata = pixels_to_pages(width, height, pixels, args.invert)
+
+    pages = len(pagedata) // width
+    text = emit_c(args.name, width, pages, pagedata, rotations)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()
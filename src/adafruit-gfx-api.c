@@ -44,40 +44,146 @@ LOG_MODULE_REGISTER(adafruit_ssd1306, CONFIG_DISPLAY_LOG_LEVEL);
 #include "adafruit-gfx-defines.h"
 #include "adafruit-gfx-cache.h"
 #include "adafruit-gfx-api.h"
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+#include "adafruit-gfx-arena.h"
+#endif
 #include "adafruit-gfx-font.h"
+#include "adafruit-gfx-latency.h"
+#include "adafruit-gfx-rop.h"
 #include "adafruit-gfx-utils.h"
 
+static void _drawPixelInternal(int x, int y, int color);
 static void _drawFastVLineInternal(int x, int y, int h, int color);
 static void _drawFastHLineInternal(int x, int y, int w, int color);
+static void _fillRectInternal(int x, int y, int w, int h, int color);
+static void _drawVSpan(int x, int y, int h, int color);
+static void _fillRawRows(int x, int y, int w, int h, int color);
+static void _rect_to_raw(int *x, int *y, int *w, int *h);
+static void _rect_to_buf(int *x, int *y, int *w, int *h);
+static int _display_window(int col_start, int col_end, int page_start, int page_end);
+static int _bus_write(uint8_t *buf, size_t len, bool command);
 static int _draw_pixels_masked(int x, int y, int color, uint8_t mask);
+static uint8_t _rows_page_mask(int page, int y, int h);
+static void _drawClassicChar(int x, int y, unsigned char c, int color, int bg, int size);
+static void _drawFontGlyph(int x, int y, const GFXfont *font, const GFXglyph *glyph,
+      int color, int size);
 
 extern int ssd1306_display_write(const struct device *dev, uint8_t *buf, size_t len, bool command);
 
+/*
+ * Staging buffer for data transfers.  Contiguous in-RAM data goes to the bus
+ * directly, so without the external cache this only has to hold a page row.
+ * The frame is staged whenever it isn't one plain buffer: in unmapped
+ * external RAM, with layers to compose on top of it, or rotated on the way
+ * out.  Memory mapped external RAM is sent in place.
+ */
+#if defined(SSD1306_CACHE_LINES) || defined(CONFIG_ADAFRUIT_SSD1306_LAYERS) || \
+    defined(CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH)
+#define SSD1306_FRAME_STAGED
+#define SSD1306_XFER_SIZE       max(SSD1306_LCDWIDTH, SSD1306_TRANSFER_SIZE)
+#else
+#define SSD1306_XFER_SIZE       (SSD1306_LCDWIDTH)
+#endif
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_LAYERS
+struct adafruit_gfx_layer_t {
+  struct adafruit_gfx_cache_source_t source;
+  int mode;	// GFX_LAYER_OR, GFX_LAYER_XOR or GFX_LAYER_MASK
+  bool visible;
+};
+#endif
+
+struct adafruit_gfx_layout_t {
+  const GFXglyph *glyph;
+  uint32_t cp;
+  int16_t x;	// pen position relative to the string origin
+  int16_t y;
+};
+
 struct adafruit_ssd1306_data_t {
   const struct device *dev;
+  struct k_mutex lock;
   struct adafruit_gfx_cache_t cache;
   struct adafruit_gfx_cache_source_t draw_cache;
   struct adafruit_gfx_cache_source_t adafruit_logo;
-#ifndef CONFIG_ADAFRUIT_SSD1306_CACHE
-  uint8_t draw_cache_buffer[SSD1306_RAM_MIRROR_SIZE];
+  struct adafruit_gfx_cache_source_t *target;	// where drawing goes
+#if defined(CONFIG_ADAFRUIT_SSD1306_STRIP_MODE)
+  uint8_t strip[SSD1306_LCDWIDTH] __aligned(4);	// the page row being rendered
+  uint8_t strip_list[CONFIG_ADAFRUIT_SSD1306_STRIP_LIST_SIZE];	// recorded draw calls
+  size_t strip_len;
+  size_t strip_last;	// offset of the last record
+  int strip_page;	// page being rendered, -1 while recording
+  bool strip_replaying;
+  bool strip_overflow;	// draw calls were dropped since the last clear
+  uint8_t strip_fill;	// what the screen was cleared to
+#elif !defined(CONFIG_ADAFRUIT_SSD1306_CACHE)
+  uint8_t draw_cache_buffer[SSD1306_RAM_MIRROR_SIZE] __aligned(4);
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_LAYERS
+  struct adafruit_gfx_layer_t layers[CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT];
+#if defined(SSD1306_CACHE_LINES)
+  uint8_t layer_row[SSD1306_LCDWIDTH] __aligned(4);
+#elif !defined(CONFIG_ADAFRUIT_SSD1306_CACHE)
+  uint8_t layer_buffer[CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT][SSD1306_RAM_MIRROR_SIZE] __aligned(4);
+#endif
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_SHADOW_FRAME
+  uint8_t shadow[SSD1306_RAM_MIRROR_SIZE] __aligned(4);	// what the panel holds
+#ifdef SSD1306_FRAME_STAGED
+  uint8_t diff_row[SSD1306_LCDWIDTH] __aligned(4);
+#endif
+  bool shadow_valid;
 #endif
   uint8_t buffer[16];
+  uint8_t xfer[SSD1306_XFER_SIZE] __aligned(4);	// staging for streamed page data
+  uint8_t xfer_row[SSD1306_LCDWIDTH] __aligned(4);	// second page row for bit scrolling, folded rows on flush
+  struct adafruit_gfx_bus_stats_t bus_stats;
   int raw_width;	// Raw display, never changes
   int raw_height;	// Raw display, never changes
   int width;	// modified by current rotation
   int height;	// modified by current rotation
+  int buf_width;	// draw buffer layout, the raw display unless folded
+  int buf_height;
+  int buf_rotation;	// rotation from logical to draw buffer coordinates
   int cursor_x;
   int cursor_y;
   int textcolor;
   int textbgcolor;
   int textsize;
   int rotation;
+  int start_line;	// hardware start line, raw row 0 of the ring
+  int clip_x0;	// logical clip rectangle, x1/y1 exclusive
+  int clip_y0;
+  int clip_x1;
+  int clip_y1;
   bool wrap;
+  bool inverted;	// panel is inverted, the buffer holds the complement
   bool cp437;  // if set, use correct CP437 characterset (default off)
+  bool utf8;   // if set, write() decodes UTF-8 sequences (default off)
+  uint32_t utf8_cp;        // code point being assembled by write()
+  uint8_t utf8_remaining;  // continuation bytes still expected
   bool show_logo;
   GFXfont *gfxFont;
+  struct adafruit_gfx_layout_t layout[CONFIG_ADAFRUIT_SSD1306_STRING_LAYOUT_SIZE];
+#ifdef CONFIG_ADAFRUIT_SSD1306_FRAME_GOVERNOR
+  struct k_work_delayable frame_work;
+  struct adafruit_gfx_frame_stats_t frame_stats;
+  int64_t frame_last;		// uptime of the last flush
+  int64_t frame_window_start;	// start of the current FPS window
+  uint32_t frame_window_count;
+  bool frame_pending;
+  bool frame_full;
+  int dirty_x0;		// pending logical dirty bounds, inclusive
+  int dirty_x1;
+  int dirty_y0;
+  int dirty_y1;
+#endif
 };
 
+#if CONFIG_ADAFRUIT_SSD1306_REGION_POOL_SIZE > 0
+K_HEAP_DEFINE(region_pool, CONFIG_ADAFRUIT_SSD1306_REGION_POOL_SIZE);
+#endif
+
 static struct adafruit_ssd1306_data_t display_data = {
   .dev = NULL,
   .rotation = 0,
@@ -88,9 +194,187 @@ static struct adafruit_ssd1306_data_t display_data = {
   .textbgcolor = WHITE,
   .wrap = true,
   .cp437 = false,
+  .utf8 = false,
   .gfxFont = NULL,
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  .strip_page = -1,
+#endif
+};
+
+// The framebuffer is a ring of rows starting at the hardware start line,
+// map a raw row to where it lives in RAM
+static inline int _ring_row(int y)
+{
+  y += display_data.start_line;
+  if (y >= display_data.buf_height) {
+    y -= display_data.buf_height;
+  }
+  return y;
+}
+
+static inline int _ring_page(int page)
+{
+  return _ring_row(page << 3) >> 3;
+}
+
+// While the panel is inverted the base buffer holds the complement of what
+// is shown.  Layers always hold what is shown, they are complemented when
+// composed.
+static inline bool _target_inverted(void)
+{
+  return display_data.inverted && display_data.target == &display_data.draw_cache;
+}
+
+// The kernels swap WHITE and BLACK when drawing into a complemented buffer
+static inline int _raster_color(int color)
+{
+  if (_target_inverted()) {
+    if (color == WHITE) {
+      return BLACK;
+    } else if (color == BLACK) {
+      return WHITE;
+    }
+  }
+  return color;
+}
+
+// Intersect a logical rectangle with the clip rectangle, false if nothing
+// is left.  The clip never extends past the screen, so this is all the
+// bounds checking a primitive needs.
+static inline bool _clip_rect(int *x, int *y, int *w, int *h)
+{
+  int x1 = min(*x + *w, display_data.clip_x1);
+  int y1 = min(*y + *h, display_data.clip_y1);
+
+  *x = max(*x, display_data.clip_x0);
+  *y = max(*y, display_data.clip_y0);
+  *w = x1 - *x;
+  *h = y1 - *y;
+
+  return (*w > 0 && *h > 0);
+}
+
+// True if a logical rectangle lies entirely outside the clip
+static inline bool _clip_reject(int x, int y, int w, int h)
+{
+  return !_clip_rect(&x, &y, &w, &h);
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+// Strip mode keeps no frame buffer.  Draw calls are recorded into a display
+// list, and display() renders the frame one page row at a time by
+// replaying the list with the clip narrowed to that row.  Each record is an
+// op byte followed by its pointers and its int16_t arguments, unaligned.
+enum {
+  STRIP_OP_STATE,	// rotation, clip x, y, w, h, inverted
+  STRIP_OP_PIXEL,
+  STRIP_OP_HLINE,
+  STRIP_OP_VLINE,
+  STRIP_OP_FILL_RECT,
+  STRIP_OP_LINE,
+  STRIP_OP_RECT,
+  STRIP_OP_CIRCLE,
+  STRIP_OP_CIRCLE_HELPER,
+  STRIP_OP_FILL_CIRCLE,
+  STRIP_OP_FILL_CIRCLE_HELPER,
+  STRIP_OP_ROUND_RECT,
+  STRIP_OP_FILL_ROUND_RECT,
+  STRIP_OP_TRIANGLE,
+  STRIP_OP_FILL_TRIANGLE,
+  STRIP_OP_BITMAP,
+  STRIP_OP_XBITMAP,
+  STRIP_OP_IMAGE,
+  STRIP_OP_CHAR,
+  STRIP_OP_GLYPH,
 };
 
+static const struct {
+  uint8_t args;
+  uint8_t ptrs;
+} strip_ops[] = {
+  [STRIP_OP_STATE]              = { 6, 0 },
+  [STRIP_OP_PIXEL]              = { 3, 0 },
+  [STRIP_OP_HLINE]              = { 4, 0 },
+  [STRIP_OP_VLINE]              = { 4, 0 },
+  [STRIP_OP_FILL_RECT]          = { 5, 0 },
+  [STRIP_OP_LINE]               = { 5, 0 },
+  [STRIP_OP_RECT]               = { 5, 0 },
+  [STRIP_OP_CIRCLE]             = { 4, 0 },
+  [STRIP_OP_CIRCLE_HELPER]      = { 5, 0 },
+  [STRIP_OP_FILL_CIRCLE]        = { 4, 0 },
+  [STRIP_OP_FILL_CIRCLE_HELPER] = { 6, 0 },
+  [STRIP_OP_ROUND_RECT]         = { 6, 0 },
+  [STRIP_OP_FILL_ROUND_RECT]    = { 6, 0 },
+  [STRIP_OP_TRIANGLE]           = { 7, 0 },
+  [STRIP_OP_FILL_TRIANGLE]      = { 7, 0 },
+  [STRIP_OP_BITMAP]             = { 6, 1 },
+  [STRIP_OP_XBITMAP]            = { 5, 1 },
+  [STRIP_OP_IMAGE]              = { 2, 1 },
+  [STRIP_OP_CHAR]               = { 6, 0 },
+  [STRIP_OP_GLYPH]              = { 4, 2 },
+};
+
+// Append a draw call to the display list.  Returns true if the call was
+// taken (recorded, or dropped because the list is full) and must not be
+// drawn now, false while replaying.
+static bool _strip_record(uint8_t op, const void *ptr0, const void *ptr1, const int16_t *args)
+{
+  const void *ptrs[2] = { ptr0, ptr1 };
+  size_t size = 1 + strip_ops[op].ptrs * sizeof(void *) + strip_ops[op].args * sizeof(int16_t);
+  size_t pos = display_data.strip_len;
+
+  if (display_data.strip_replaying) {
+    return false;
+  }
+
+  // Consecutive state changes only need the last one
+  if (op == STRIP_OP_STATE && pos && display_data.strip_list[display_data.strip_last] == op) {
+    pos = display_data.strip_last;
+  }
+
+  if (pos + size > sizeof(display_data.strip_list)) {
+    display_data.strip_overflow = true;
+    return true;
+  }
+
+  display_data.strip_last = pos;
+  display_data.strip_list[pos++] = op;
+  memcpy(&display_data.strip_list[pos], ptrs, strip_ops[op].ptrs * sizeof(void *));
+  pos += strip_ops[op].ptrs * sizeof(void *);
+  memcpy(&display_data.strip_list[pos], args, strip_ops[op].args * sizeof(int16_t));
+  display_data.strip_len = pos + strip_ops[op].args * sizeof(int16_t);
+  return true;
+}
+
+#define STRIP_RECORD(op, ptr0, ptr1, ...) \
+  _strip_record(op, ptr0, ptr1, (const int16_t[]){ __VA_ARGS__ })
+
+// Record the drawing state the following calls depend on
+static void _strip_state(void)
+{
+  STRIP_RECORD(STRIP_OP_STATE, NULL, NULL, display_data.rotation,
+               display_data.clip_x0, display_data.clip_y0,
+               display_data.clip_x1 - display_data.clip_x0,
+               display_data.clip_y1 - display_data.clip_y0,
+               display_data.inverted);
+}
+
+// Start a new display list for a screen filled with fill
+static void _strip_reset(uint8_t fill)
+{
+  display_data.strip_len = 0;
+  display_data.strip_overflow = false;
+  display_data.strip_fill = fill;
+  _strip_state();
+}
+#else
+#define STRIP_RECORD(op, ptr0, ptr1, ...)   false
+#endif
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_FRAME_GOVERNOR
+static void _frame_work_handler(struct k_work *work);
+#endif
+
 int adafruit_gfx_initialize(void) {
   int ret = 0;
   
@@ -101,12 +385,17 @@ int adafruit_gfx_initialize(void) {
 		return -EINVAL;
 	}
 
+  k_mutex_init(&display_data.lock);
+
   struct display_capabilities caps;
   display_get_capabilities(display_data.dev, &caps);
   display_data.raw_width = caps.x_resolution;
   display_data.raw_height = caps.y_resolution;
   display_data.width = display_data.raw_width;
   display_data.height = display_data.raw_height;
+  display_data.buf_width = display_data.raw_width;
+  display_data.buf_height = display_data.raw_height;
+  adafruit_gfx_resetClip();
 
   ret = adafruit_gfx_cache_init(&display_data.cache);
   if (ret != 0) {
@@ -114,7 +403,9 @@ int adafruit_gfx_initialize(void) {
   }
 
   uint8_t *buf = NULL;
-#ifndef CONFIG_ADAFRUIT_SSD1306_CACHE
+#if defined(CONFIG_ADAFRUIT_SSD1306_STRIP_MODE)
+  buf = display_data.strip;
+#elif !defined(CONFIG_ADAFRUIT_SSD1306_CACHE)
   buf = display_data.draw_cache_buffer;
 #endif
 
@@ -128,11 +419,58 @@ int adafruit_gfx_initialize(void) {
   if (ret != 0) {
     return ret;
   }
+  display_data.target = &display_data.draw_cache;
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_LAYERS
+  // Layers follow the logo in external RAM, and start out clear and hidden
+  for (int i = 0; i < CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT; i++) {
+    struct adafruit_gfx_layer_t *layer = &display_data.layers[i];
+
+    buf = NULL;
+#ifndef CONFIG_ADAFRUIT_SSD1306_CACHE
+    buf = display_data.layer_buffer[i];
+#endif
+    ret = adafruit_gfx_cache_source_init(&display_data.cache, &layer->source,
+                                         (i + 2) * SSD1306_RAM_MIRROR_SIZE, buf);
+    if (ret == 0) {
+      ret = adafruit_gfx_cache_source_choose(&display_data.cache, &layer->source);
+    }
+    if (ret == 0) {
+      ret = adafruit_gfx_cache_fill_all(&display_data.cache, 0x00);
+    }
+    if (ret != 0) {
+      return ret;
+    }
+
+    layer->mode = GFX_LAYER_OR;
+    layer->visible = false;
+  }
+#endif
   
+#ifdef CONFIG_ADAFRUIT_SSD1306_FRAME_GOVERNOR
+  k_work_init_delayable(&display_data.frame_work, _frame_work_handler);
+  display_data.frame_window_start = k_uptime_get();
+#endif
+
   adafruit_gfx_reset();
   return 0;
 }
 
+// Serialize access to the library between threads.  Recursive.  The
+// display calls take it themselves; drawing does not, so with the frame
+// governor enabled (which flushes from the system work queue) every thread
+// must hold it around its drawing and the request that follows, or the
+// flush can send a half drawn frame.
+void adafruit_gfx_lock(void)
+{
+  k_mutex_lock(&display_data.lock, K_FOREVER);
+}
+
+void adafruit_gfx_unlock(void)
+{
+  k_mutex_unlock(&display_data.lock);
+}
+
 void adafruit_gfx_reset(void) {
   adafruit_gfx_clearDisplay();
   display_data.show_logo = true;
@@ -157,7 +495,7 @@ int adafruit_gfx_startScrollRight(uint8_t start, uint8_t stop)
   buf[buflen++] = 0xFF;
   buf[buflen++] = SSD1306_ACTIVATE_SCROLL;
 
-  return ssd1306_display_write(display_data.dev, buf, buflen, true);
+  return _bus_write(buf, buflen, true);
 }
 
 // startScrollLeft
@@ -178,7 +516,7 @@ int adafruit_gfx_startScrollLeft(uint8_t start, uint8_t stop)
   buf[buflen++] = 0xFF;
   buf[buflen++] = SSD1306_ACTIVATE_SCROLL;
 
-  return ssd1306_display_write(display_data.dev, buf, buflen, true);
+  return _bus_write(buf, buflen, true);
 }
 
 // startScrollDiagRight
@@ -201,7 +539,7 @@ int adafruit_gfx_startScrollDiagRight(uint8_t start, uint8_t stop)
   buf[buflen++] = 0x01;
   buf[buflen++] = SSD1306_ACTIVATE_SCROLL;
 
-  return ssd1306_display_write(display_data.dev, buf, buflen, true);
+  return _bus_write(buf, buflen, true);
 }
 
 // startScrollDiagLeft
@@ -224,7 +562,7 @@ int adafruit_gfx_startScrollDiagLeft(uint8_t start, uint8_t stop)
   buf[buflen++] = 0x01;
   buf[buflen++] = SSD1306_ACTIVATE_SCROLL;
 
-  return ssd1306_display_write(display_data.dev, buf, buflen, true);
+  return _bus_write(buf, buflen, true);
 }
 
 int adafruit_gfx_stopScroll(void)
@@ -234,183 +572,1623 @@ int adafruit_gfx_stopScroll(void)
   
   buf[buflen++] = SSD1306_DEACTIVATE_SCROLL;
 
-  return ssd1306_display_write(display_data.dev, buf, buflen, true);
+  return _bus_write(buf, buflen, true);
 }
 
-int adafruit_gfx_display(void) 
+// Every transfer to the panel goes through here
+static int _bus_write(uint8_t *buf, size_t len, bool command)
 {
-  uint8_t *buf = display_data.buffer;
-  size_t buflen = 0;
-  
-  buf[buflen++] = SSD1306_COLUMNADDR;
-  buf[buflen++] = 0;                    // Column start address (0 = reset)
-  buf[buflen++] = SSD1306_LCDWIDTH - 1; // Column end address (127 = reset)
-  buf[buflen++] = SSD1306_PAGEADDR;
-  buf[buflen++] = 0;                    // Page start address (0 = reset)
-  buf[buflen++] = (SSD1306_LCDHEIGHT >> 3) - 1; // Page end address
-  int ret = ssd1306_display_write(display_data.dev, buf, buflen, true);
-  
-  if (ret != 0) {
-    return ret;
+  LATENCY_SCOPE(GFX_LATENCY_BUS);
+
+  display_data.bus_stats.transactions++;
+  if (command) {
+    display_data.bus_stats.command_bytes += len;
+  } else {
+    display_data.bus_stats.data_bytes += len;
   }
 
-  struct adafruit_gfx_cache_source_t *source = (display_data.show_logo ? &display_data.adafruit_logo : &display_data.draw_cache);
-  ret = adafruit_gfx_cache_source_choose(&display_data.cache, source);
-  if (ret != 0) {
+  return ssd1306_display_write(display_data.dev, buf, len, command);
+}
+
+void adafruit_gfx_bus_stats(struct adafruit_gfx_bus_stats_t *stats, bool reset)
+{
+  if (stats) {
+    *stats = display_data.bus_stats;
+  }
+
+  if (reset) {
+    memset(&display_data.bus_stats, 0, sizeof(display_data.bus_stats));
+  }
+}
+
+void adafruit_gfx_cache_stats(struct adafruit_gfx_cache_stats_t *stats, bool reset)
+{
+  k_mutex_lock(&display_data.lock, K_FOREVER);
+  adafruit_gfx_cache_get_stats(&display_data.cache, stats, reset);
+  k_mutex_unlock(&display_data.lock);
+}
+
+// The buffer cache with the drawing target chosen, for writing pixels
+// directly through adafruit_gfx_cache_get_pixel_addr() under
+// adafruit_gfx_lock().  Addresses are in the draw buffer's own layout,
+// not logical coordinates.
+struct adafruit_gfx_cache_t *adafruit_gfx_getCache(void)
+{
+  if (adafruit_gfx_cache_source_choose(&display_data.cache, display_data.target) != 0) {
+    return NULL;
+  }
+  return &display_data.cache;
+}
+
+// The splash logo replaces the draw buffer until the first frame is sent
+static inline struct adafruit_gfx_cache_source_t *_frame_source(void)
+{
+  return display_data.show_logo ? &display_data.adafruit_logo : &display_data.draw_cache;
+}
+
+static inline bool _layers_visible(void)
+{
+#ifdef CONFIG_ADAFRUIT_SSD1306_LAYERS
+  for (int i = 0; i < CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT; i++) {
+    if (display_data.layers[i].visible) {
+      return true;
+    }
+  }
+#endif
+  return false;
+}
+
+// True while the draw buffer is folded into the logical orientation
+static inline bool _buf_folded(void)
+{
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+  return (display_data.rotation & 1) != 0;
+#else
+  return false;
+#endif
+}
+
+#ifdef SSD1306_FRAME_STAGED
+// Read len bytes of the frame starting at draw buffer address addr: the
+// draw buffer with every visible layer composed on top in layer order.
+static int _frame_compose(size_t addr, uint8_t *buf, size_t len)
+{
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, _frame_source());
+  if (ret == 0) {
+    ret = adafruit_gfx_cache_read(&display_data.cache, addr, 0, buf, len);
+  }
+  if (ret != 0 || display_data.show_logo) {
     return ret;
   }
-  
-  size_t line_addr;
-  uint8_t *pixel_addr;
-  
-  for (line_addr = 0; line_addr < SSD1306_RAM_MIRROR_SIZE; line_addr += SSD1306_CACHE_LINE_SIZE) {
-    /*
-     * Send one cache row at a time.  This allows us to add support for external RAM
-     * with a minimal on-CPU cache.
-     */
-    ret = adafruit_gfx_cache_get_pixel_addr(&display_data.cache, line_addr, 0, &pixel_addr); 
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_LAYERS
+  for (int i = 0; i < CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT; i++) {
+    struct adafruit_gfx_layer_t *layer = &display_data.layers[i];
+    if (!layer->visible) {
+      continue;
+    }
+
+    // Layers hold what is shown, so against a complemented base OR and
+    // MASK trade places
+    rop_t rop = ROP_XOR;
+    if (layer->mode == GFX_LAYER_OR) {
+      rop = display_data.inverted ? ROP_ANDNOT : ROP_OR;
+    } else if (layer->mode == GFX_LAYER_MASK) {
+      rop = display_data.inverted ? ROP_OR : ROP_ANDNOT;
+    }
+
+    ret = adafruit_gfx_cache_source_choose(&display_data.cache, &layer->source);
     if (ret != 0) {
       return ret;
     }
 
-    ret = ssd1306_display_write(display_data.dev, pixel_addr, SSD1306_CACHE_LINE_SIZE, false);
+    for (size_t done = 0; done < len; ) {
+      uint8_t *data;
+      size_t n = len - done;
+
+#ifdef SSD1306_CACHE_LINES
+      data = display_data.layer_row;
+      n = min(n, sizeof(display_data.layer_row));
+      ret = adafruit_gfx_cache_read(&display_data.cache, addr + done, 0, data, n);
+#else
+      ret = adafruit_gfx_cache_get_pixel_addr(&display_data.cache, addr + done, 0, &data);
+#endif
+      if (ret != 0) {
+        return ret;
+      }
+
+      adafruit_gfx_rop_compose(&buf[done], data, n, rop);
+      done += n;
+    }
+  }
+#endif
+
+  return 0;
+}
+#endif
+
+// Send len bytes of the frame starting at RAM address addr, in
+// transactions of up to SSD1306_TRANSFER_SIZE bytes.  Without the external
+// cache the data is sent in place, so a whole frame can go out as a single
+// (DMA friendly) transaction.
+static int _send_range(size_t addr, size_t len)
+{
+  while (len) {
+    size_t n = min(len, (size_t)SSD1306_TRANSFER_SIZE);
+    uint8_t *data;
+    int ret;
+
+#ifdef SSD1306_FRAME_STAGED
+    data = display_data.xfer;
+    ret = _frame_compose(addr, data, n);
+#else
+    ret = adafruit_gfx_cache_source_choose(&display_data.cache, _frame_source());
+    if (ret == 0) {
+      ret = adafruit_gfx_cache_get_pixel_addr(&display_data.cache, addr, 0, &data);
+    }
+#endif
     if (ret != 0) {
       return ret;
     }
-  }
 
-  if (display_data.show_logo) {
-    adafruit_gfx_clearDisplay();
+    ret = _bus_write(data, n, false);
+    if (ret != 0) {
+      return ret;
+    }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_SHADOW_FRAME
+    memcpy(&display_data.shadow[addr], data, n);
+#endif
+    addr += n;
+    len -= n;
   }
-  
+
   return 0;
 }
 
-// clear everything
-void adafruit_gfx_clearDisplay(void) {
-  display_data.show_logo = false;
+// Set the RAM window that following data writes will fill
+static int _set_window(int col_start, int col_end, int page_start, int page_end)
+{
+  uint8_t *buf = display_data.buffer;
+  size_t buflen = 0;
   
-  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, &display_data.draw_cache);
-  if (ret == 0) {
-    adafruit_gfx_cache_clear_all(&display_data.cache);
-  }
+  buf[buflen++] = SSD1306_COLUMNADDR;
+  buf[buflen++] = col_start;
+  buf[buflen++] = col_end;
+  buf[buflen++] = SSD1306_PAGEADDR;
+  buf[buflen++] = page_start;
+  buf[buflen++] = page_end;
+
+  return _bus_write(buf, buflen, true);
 }
 
-// the most basic function, set a single pixel
-void adafruit_gfx_drawPixel(int x, int y, int color)
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+// Panel columns turned from one composed band: as many whole folded page
+// rows (8 logical rows, 8 panel columns each) as xfer_row holds
+static inline int _band_cols(void)
 {
-  if ((x < 0) || (x >= display_data.width) || (y < 0) || (y >= display_data.height))
-    return;
+  return (sizeof(display_data.xfer_row) / display_data.buf_width) << 3;
+}
 
-  // check rotation, move pixel around if necessary
-  switch (display_data.rotation) {
-  case 1:
-    _swap_int(x, y);
-    x = display_data.raw_width - x - 1;
-    break;
-  case 2:
-    x = display_data.raw_width - x - 1;
-    y = display_data.raw_height - y - 1;
-    break;
-  case 3:
-    _swap_int(x, y);
-    y = display_data.raw_height - y - 1;
-    break;
+// Read panel columns col..col+cols-1 (8 aligned, at most _band_cols()) of
+// every page from the folded draw buffer.  The folded page rows behind
+// them are composed once, in one piece, then each 8x8 bit tile is
+// transposed and flipped to match the rotation.  out is page major, cols
+// bytes per page.
+static int _frame_read_band(int col, int cols, uint8_t *out)
+{
+  int w = display_data.buf_width;
+  int rows = cols >> 3;
+  int first = (display_data.rotation == 1) ? (display_data.raw_width - col - cols) >> 3 : col >> 3;
+  uint8_t *folded = display_data.xfer_row;
+  uint8_t bits[8];
+
+  int ret = _frame_compose(first * w, folded, rows * w);
+  if (ret != 0) {
+    return ret;
   }
 
-  _draw_pixels_masked(x, y, color, SSD1306_PIXEL_MASK(y));
-}
+  for (int b = 0; b < rows; b++) {
+    for (int page = 0; page < (display_data.raw_height >> 3); page++) {
+      uint8_t *dst = &out[page * cols + (b << 3)];
 
+      if (display_data.rotation == 1) {
+        adafruit_gfx_rop_transpose8(&folded[(rows - 1 - b) * w + (page << 3)], bits);
+        for (int i = 0; i < 8; i++) {
+          dst[i] = bits[7 - i];
+        }
+      } else {
+        const uint8_t *tile = &folded[b * w + w - 8 - (page << 3)];
 
-void adafruit_gfx_drawFastHLine(int x, int y, int w, int color) 
-{
-  int bSwap = 0;
-  switch(display_data.rotation) {
-    case 0:
-      // 0 degree rotation, do nothing
-      break;
-    case 1:
-      // 90 degree rotation, swap x & y for rotation, then invert x
-      bSwap = 1;
-      _swap_int(x, y);
-      x = display_data.raw_width - x - 1;
-      break;
-    case 2:
-      // 180 degree rotation, invert x and y - then shift y around for height.
-      x = display_data.raw_width - x - 1;
-      y = display_data.raw_height - y - 1;
-      x -= (w-1);
-      break;
-    case 3:
-      // 270 degree rotation, swap x & y for rotation, then invert y  and adjust y for w (not to become h)
-      bSwap = 1;
-      _swap_int(x, y);
-      y = display_data.raw_height - y - 1;
-      y -= (w-1);
-      break;
+        for (int i = 0; i < 8; i++) {
+          bits[i] = tile[7 - i];
+        }
+        adafruit_gfx_rop_transpose8(bits, dst);
+      }
+    }
   }
 
-  if(bSwap) {
-    _drawFastVLineInternal(x, y, w, color);
-  } else {
-    _drawFastHLineInternal(x, y, w, color);
-  }
+  return 0;
 }
 
-static void _drawFastHLineInternal(int x, int y, int w, int color) 
+// Send columns col_start..col_end of pages page_start..page_end out of a
+// band read into the staging buffer, packing them down in place
+static int _band_send(int col, int cols, int col_start, int col_end, int page_start, int page_end)
 {
-  // Do bounds/limit checks
-  if (y < 0 || y >= display_data.raw_height) {
-    return;
-  }
+  uint8_t *data = display_data.xfer;
+  size_t n = col_end - col_start + 1;
+  size_t len = 0;
 
-  // make sure we don't try to draw below 0
-  if (x < 0) {
-    w += x;
-    x = 0;
+  int ret = _set_window(col_start, col_end, page_start, page_end);
+  if (ret != 0) {
+    return ret;
   }
 
-  // make sure we don't go off the edge of the display
-  if ((x + w) > display_data.raw_width) {
-    w = (display_data.raw_width - x);
+  for (int page = page_start; page <= page_end; page++) {
+    memmove(&data[len], &data[page * cols + col_start - col], n);
+#ifdef CONFIG_ADAFRUIT_SSD1306_SHADOW_FRAME
+    memcpy(&display_data.shadow[col_start + page * SSD1306_LCDWIDTH], &data[len], n);
+#endif
+    len += n;
   }
 
-  // if our width is now negative, punt
-  if (w <= 0) {
-    return;
+  for (size_t done = 0; done < len; done += n) {
+    n = min(len - done, (size_t)SSD1306_TRANSFER_SIZE);
+    ret = _bus_write(&data[done], n, false);
+    if (ret != 0) {
+      return ret;
+    }
   }
 
-  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, &display_data.draw_cache);
-  if (ret != 0) {
-    return;
-  }
-  
-  _draw_pixels_masked(x, y, color, SSD1306_PIXEL_MASK(y));
+  return 0;
 }
 
-void adafruit_gfx_drawFastVLine(int x, int y, int h, int color) {
-  int bSwap = 0;
-  switch(display_data.rotation) {
-    case 0:
-      break;
-    case 1:
-      // 90 degree rotation, swap x & y for rotation, then invert x and adjust x for h (now to become w)
+// Send a window of a folded frame, a band of columns at a time
+static int _display_folded(int col_start, int col_end, int page_start, int page_end)
+{
+  int cols = _band_cols();
+
+  for (int col = col_start & ~0x07; col <= col_end; col += cols) {
+    int n = min(cols, display_data.raw_width - col);
+
+    int ret = _frame_read_band(col, n, display_data.xfer);
+    if (ret == 0) {
+      ret = _band_send(col, n, max(col_start, col), min(col_end, col + n - 1),
+                       page_start, page_end);
+    }
+    if (ret != 0) {
+      return ret;
+    }
+  }
+
+  return 0;
+}
+#endif
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_SHADOW_FRAME
+struct adafruit_gfx_diff_window_t {
+  int col_start;
+  int col_end;
+  int page_start;
+  int page_end;
+};
+
+// Queue a changed run for sending, growing the pending window downwards
+// when consecutive pages changed over the same columns
+static int _diff_emit(struct adafruit_gfx_diff_window_t *win, int col_start, int col_end, int page)
+{
+  int ret = 0;
+
+  if (win->page_start >= 0 && win->col_start == col_start &&
+      win->col_end == col_end && win->page_end == page - 1) {
+    win->page_end = page;
+    return 0;
+  }
+
+  if (win->page_start >= 0) {
+    ret = _display_window(win->col_start, win->col_end, win->page_start, win->page_end);
+  }
+
+  win->col_start = col_start;
+  win->col_end = col_end;
+  win->page_start = page;
+  win->page_end = page;
+  return ret;
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+// The folded frame is compared a band at a time, straight out of the band
+// it was turned into, and each band sends the box around its changes.
+// Sets *sent when anything went out.
+static int _display_diff_folded(bool *sent)
+{
+  int cols = _band_cols();
+  uint8_t *data = display_data.xfer;
+
+  for (int col = 0; col < display_data.raw_width; col += cols) {
+    int n = min(cols, display_data.raw_width - col);
+    int col_start = n;
+    int col_end = -1;
+    int page_start = -1;
+    int page_end = -1;
+
+    int ret = _frame_read_band(col, n, data);
+    if (ret != 0) {
+      return ret;
+    }
+
+    for (int page = 0; page < (SSD1306_LCDHEIGHT >> 3); page++) {
+      const uint8_t *row = &data[page * n];
+      const uint8_t *old = &display_data.shadow[col + page * SSD1306_LCDWIDTH];
+      int first = 0;
+      int last = n - 1;
+
+      if (memcmp(row, old, n) == 0) {
+        continue;
+      }
+      while (row[first] == old[first]) {
+        first++;
+      }
+      while (row[last] == old[last]) {
+        last--;
+      }
+
+      col_start = min(col_start, first);
+      col_end = max(col_end, last);
+      if (page_start < 0) {
+        page_start = page;
+      }
+      page_end = page;
+    }
+
+    if (page_start >= 0) {
+      ret = _band_send(col, n, col + col_start, col + col_end, page_start, page_end);
+      if (ret != 0) {
+        return ret;
+      }
+      *sent = true;
+    }
+  }
+
+  return 0;
+}
+#endif
+
+// Send only what changed since the last transfer.  Each page row of the
+// draw buffer is compared a word at a time against the shadow copy of the
+// panel, and the differing runs are sent as narrow windows.  Runs separated
+// by fewer than CONFIG_ADAFRUIT_SSD1306_SHADOW_MERGE_GAP unchanged bytes are
+// merged, as resending those is cheaper than another window command.
+static int _display_diff(void)
+{
+  struct adafruit_gfx_diff_window_t win = { .page_start = -1 };
+  int ret;
+
+  if (!display_data.shadow_valid) {
+    ret = _display_window(0, SSD1306_LCDWIDTH - 1, 0, (SSD1306_LCDHEIGHT >> 3) - 1);
+    display_data.shadow_valid = (ret == 0);
+    if (ret == 0) {
+      display_data.bus_stats.frames++;
+    }
+    return ret;
+  }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+  if (_buf_folded()) {
+    bool sent = false;
+
+    ret = _display_diff_folded(&sent);
+    if (ret == 0 && sent) {
+      display_data.bus_stats.frames++;
+    }
+    return ret;
+  }
+#endif
+
+  for (int page = 0; page < (SSD1306_LCDHEIGHT >> 3); page++) {
+    const uint8_t *old = &display_data.shadow[page * SSD1306_LCDWIDTH];
+    uint8_t *row;
+
+#ifdef SSD1306_FRAME_STAGED
+    row = display_data.diff_row;
+    ret = _frame_compose(page * SSD1306_LCDWIDTH, row, SSD1306_LCDWIDTH);
+#else
+    ret = adafruit_gfx_cache_source_choose(&display_data.cache, &display_data.draw_cache);
+    if (ret == 0) {
+      ret = adafruit_gfx_cache_get_pixel_addr(&display_data.cache, 0, page << 3, &row);
+    }
+#endif
+    if (ret != 0) {
+      return ret;
+    }
+
+    int run_start = -1;
+    int run_end = -1;
+    // Four bytes at a time.  memcmp() of a constant size compiles to a word
+    // compare, without the aliasing and alignment trouble of a cast.
+    for (int i = 0; i < SSD1306_LCDWIDTH; i += sizeof(uint32_t)) {
+      if (memcmp(&row[i], &old[i], sizeof(uint32_t)) == 0) {
+        continue;
+      }
+
+      // Trim the word down to the bytes that actually differ
+      int first = i;
+      int last = i + sizeof(uint32_t) - 1;
+      while (row[first] == old[first]) {
+        first++;
+      }
+      while (row[last] == old[last]) {
+        last--;
+      }
+
+      if (run_start >= 0 && first - run_end - 1 <= CONFIG_ADAFRUIT_SSD1306_SHADOW_MERGE_GAP) {
+        run_end = last;
+        continue;
+      }
+
+      if (run_start >= 0) {
+        ret = _diff_emit(&win, run_start, run_end, page);
+        if (ret != 0) {
+          return ret;
+        }
+      }
+      run_start = first;
+      run_end = last;
+    }
+
+    if (run_start >= 0) {
+      ret = _diff_emit(&win, run_start, run_end, page);
+      if (ret != 0) {
+        return ret;
+      }
+    }
+  }
+
+  // An unchanged frame sends nothing and isn't counted
+  if (win.page_start >= 0) {
+    ret = _display_window(win.col_start, win.col_end, win.page_start, win.page_end);
+    if (ret == 0) {
+      display_data.bus_stats.frames++;
+    }
+  }
+
+  return ret;
+}
+#endif
+
+static int _display_frame(void)
+{
+  LATENCY_SCOPE(GFX_LATENCY_DISPLAY);
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_SHADOW_FRAME
+  if (!display_data.show_logo) {
+    return _display_diff();
+  }
+  display_data.shadow_valid = false;
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  if (!display_data.show_logo) {
+    int ret = _display_window(0, SSD1306_LCDWIDTH - 1, 0, (SSD1306_LCDHEIGHT >> 3) - 1);
+    if (ret == 0) {
+      display_data.bus_stats.frames++;
+    }
+    return ret;
+  }
+#endif
+
+  int ret = _display_window(0, SSD1306_LCDWIDTH - 1, 0, (SSD1306_LCDHEIGHT >> 3) - 1);
+  if (ret != 0) {
+    return ret;
+  }
+  display_data.bus_stats.frames++;
+
+  if (display_data.show_logo) {
+    adafruit_gfx_clearDisplay();
+  }
+  
+  return 0;
+}
+
+// Send the whole frame.  Holds the library lock while the frame goes out,
+// so it cannot interleave with a frame governor flush.
+int adafruit_gfx_display(void) 
+{
+  k_mutex_lock(&display_data.lock, K_FOREVER);
+  int ret = _display_frame();
+  k_mutex_unlock(&display_data.lock);
+  return ret;
+}
+
+// Clip a logical rectangle to the screen, false if nothing is left
+static bool _clip_logical(int *x, int *y, int *w, int *h)
+{
+  if (*x < 0) {
+    *w += *x;
+    *x = 0;
+  }
+  if (*y < 0) {
+    *h += *y;
+    *y = 0;
+  }
+  *w = min(*w, display_data.width - *x);
+  *h = min(*h, display_data.height - *y);
+
+  return (*w > 0 && *h > 0);
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+// Replay the display list into the strip for one page row
+static void _strip_render(int page)
+{
+  int rotation = display_data.rotation;
+  int x, y, w, h;
+  bool inverted = display_data.inverted;
+  size_t pos = 0;
+
+  adafruit_gfx_getClipRect(&x, &y, &w, &h);
+  adafruit_gfx_rop_fill(display_data.strip, SSD1306_LCDWIDTH, display_data.strip_fill);
+  display_data.cache.origin = page * SSD1306_LCDWIDTH;
+  display_data.strip_page = page;
+  display_data.strip_replaying = true;
+
+  while (pos < display_data.strip_len) {
+    uint8_t op = display_data.strip_list[pos++];
+    const void *ptr[2];
+    int16_t a[7];
+
+    memcpy(ptr, &display_data.strip_list[pos], strip_ops[op].ptrs * sizeof(void *));
+    pos += strip_ops[op].ptrs * sizeof(void *);
+    memcpy(a, &display_data.strip_list[pos], strip_ops[op].args * sizeof(int16_t));
+    pos += strip_ops[op].args * sizeof(int16_t);
+
+    switch (op) {
+      case STRIP_OP_STATE:
+        adafruit_gfx_setRotation(a[0]);
+        adafruit_gfx_setClipRect(a[1], a[2], a[3], a[4]);
+        display_data.inverted = a[5];
+        break;
+      case STRIP_OP_PIXEL:
+        adafruit_gfx_drawPixel(a[0], a[1], a[2]);
+        break;
+      case STRIP_OP_HLINE:
+        adafruit_gfx_drawFastHLine(a[0], a[1], a[2], a[3]);
+        break;
+      case STRIP_OP_VLINE:
+        adafruit_gfx_drawFastVLine(a[0], a[1], a[2], a[3]);
+        break;
+      case STRIP_OP_FILL_RECT:
+        adafruit_gfx_fillRect(a[0], a[1], a[2], a[3], a[4]);
+        break;
+      case STRIP_OP_LINE:
+        adafruit_gfx_drawLine(a[0], a[1], a[2], a[3], a[4]);
+        break;
+      case STRIP_OP_RECT:
+        adafruit_gfx_drawRect(a[0], a[1], a[2], a[3], a[4]);
+        break;
+      case STRIP_OP_CIRCLE:
+        adafruit_gfx_drawCircle(a[0], a[1], a[2], a[3]);
+        break;
+      case STRIP_OP_CIRCLE_HELPER:
+        adafruit_gfx_drawCircleHelper(a[0], a[1], a[2], a[3], a[4]);
+        break;
+      case STRIP_OP_FILL_CIRCLE:
+        adafruit_gfx_fillCircle(a[0], a[1], a[2], a[3]);
+        break;
+      case STRIP_OP_FILL_CIRCLE_HELPER:
+        adafruit_gfx_fillCircleHelper(a[0], a[1], a[2], a[3], a[4], a[5]);
+        break;
+      case STRIP_OP_ROUND_RECT:
+        adafruit_gfx_drawRoundRect(a[0], a[1], a[2], a[3], a[4], a[5]);
+        break;
+      case STRIP_OP_FILL_ROUND_RECT:
+        adafruit_gfx_fillRoundRect(a[0], a[1], a[2], a[3], a[4], a[5]);
+        break;
+      case STRIP_OP_TRIANGLE:
+        adafruit_gfx_drawTriangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+        break;
+      case STRIP_OP_FILL_TRIANGLE:
+        adafruit_gfx_fillTriangle(a[0], a[1], a[2], a[3], a[4], a[5], a[6]);
+        break;
+      case STRIP_OP_BITMAP:
+        adafruit_gfx_drawBitmap(a[0], a[1], (uint8_t *)ptr[0], a[2], a[3], a[4], a[5]);
+        break;
+      case STRIP_OP_XBITMAP:
+        adafruit_gfx_drawXBitmap(a[0], a[1], ptr[0], a[2], a[3], a[4]);
+        break;
+      case STRIP_OP_IMAGE:
+        adafruit_gfx_drawImage(a[0], a[1], ptr[0]);
+        break;
+      case STRIP_OP_CHAR:
+        _drawClassicChar(a[0], a[1], a[2], a[3], a[4], a[5]);
+        break;
+      case STRIP_OP_GLYPH:
+        _drawFontGlyph(a[0], a[1], ptr[0], ptr[1], a[2], a[3]);
+        break;
+    }
+  }
+
+  // Back to the state drawing left off in, which the list ends with
+  display_data.strip_page = -1;
+  adafruit_gfx_setRotation(rotation);
+  adafruit_gfx_setClipRect(x, y, w, h);
+  display_data.inverted = inverted;
+  display_data.strip_replaying = false;
+  display_data.cache.origin = 0;
+}
+
+// Render and send RAM columns col_start..col_end of pages
+// page_start..page_end, one strip at a time
+static int _strip_send(int col_start, int col_end, int page_start, int page_end)
+{
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, &display_data.draw_cache);
+  if (ret != 0) {
+    return ret;
+  }
+
+  for (int page = page_start; page <= page_end; page++) {
+    _strip_render(page);
+    ret = _bus_write(&display_data.strip[col_start], col_end - col_start + 1, false);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+
+  return display_data.strip_overflow ? -ENOMEM : 0;
+}
+#endif
+
+// Send RAM columns col_start..col_end of pages page_start..page_end from
+// the draw buffer.  Full-width windows are one contiguous range; narrower
+// ones are gathered a page row at a time into the staging buffer so several
+// pages share a transaction.  Only the bytes inside the window are read,
+// even from external RAM.
+static int _display_window(int col_start, int col_end, int page_start, int page_end)
+{
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+  if (_buf_folded() && !display_data.show_logo) {
+    return _display_folded(col_start, col_end, page_start, page_end);
+  }
+#endif
+
+  int ret = _set_window(col_start, col_end, page_start, page_end);
+  if (ret != 0) {
+    return ret;
+  }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  if (!display_data.show_logo) {
+    return _strip_send(col_start, col_end, page_start, page_end);
+  }
+#endif
+
+  if (col_start == 0 && col_end == SSD1306_LCDWIDTH - 1) {
+    return _send_range(page_start * SSD1306_LCDWIDTH,
+                       (page_end - page_start + 1) * SSD1306_LCDWIDTH);
+  }
+
+  size_t limit = min(sizeof(display_data.xfer), (size_t)SSD1306_TRANSFER_SIZE);
+  size_t used = 0;
+
+  for (int page = page_start; page <= page_end; page++) {
+    int col = col_start;
+
+    while (col <= col_end) {
+      size_t n = min((size_t)(col_end - col + 1), limit - used);
+      uint8_t *data = &display_data.xfer[used];
+
+#ifdef SSD1306_FRAME_STAGED
+      ret = _frame_compose(SSD1306_PIXEL_ADDR(col, page << 3), data, n);
+#else
+      ret = adafruit_gfx_cache_source_choose(&display_data.cache, _frame_source());
+      if (ret == 0) {
+        ret = adafruit_gfx_cache_read(&display_data.cache, col, page << 3, data, n);
+      }
+#endif
+      if (ret != 0) {
+        return ret;
+      }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_SHADOW_FRAME
+      memcpy(&display_data.shadow[col + page * SSD1306_LCDWIDTH], data, n);
+#endif
+      col += n;
+      used += n;
+
+      if (used == limit) {
+        ret = _bus_write(display_data.xfer, used, false);
+        if (ret != 0) {
+          return ret;
+        }
+        used = 0;
+      }
+    }
+  }
+
+  if (used) {
+    ret = _bus_write(display_data.xfer, used, false);
+  }
+
+  return ret;
+}
+
+// Send the RAM pages holding raw rows y..y+h-1, allowing for the ring
+static int _display_raw_rows(int col_start, int col_end, int y, int h)
+{
+  int ret;
+
+  y = _ring_row(y);
+  if (y + h > display_data.raw_height) {
+    int first = display_data.raw_height - y;
+    ret = _display_window(col_start, col_end, y >> 3, (display_data.raw_height - 1) >> 3);
+    if (ret != 0) {
+      return ret;
+    }
+    y = 0;
+    h -= first;
+  }
+
+  return _display_window(col_start, col_end, y >> 3, (y + h - 1) >> 3);
+}
+
+// Send only the logical rectangle (x, y, w, h) to the panel.  The
+// rectangle is mapped through the rotation to a narrow column/page window,
+// so a small widget costs a handful of bytes instead of the whole frame.
+int adafruit_gfx_displayRegion(int x, int y, int w, int h)
+{
+  int ret = 0;
+
+  k_mutex_lock(&display_data.lock, K_FOREVER);
+  if (_clip_logical(&x, &y, &w, &h)) {
+    _rect_to_raw(&x, &y, &w, &h);
+    ret = _display_raw_rows(x, x + w - 1, y, h);
+  }
+  k_mutex_unlock(&display_data.lock);
+
+  return ret;
+}
+
+// Send only the logical rows y..y+h-1 to the panel, e.g. the rows exposed
+// by adafruit_gfx_scrollVertical() once they have been drawn
+int adafruit_gfx_displayRows(int y, int h)
+{
+  return adafruit_gfx_displayRegion(0, y, display_data.width, h);
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_FRAME_GOVERNOR
+#define FRAME_PERIOD_MS  (1000 / CONFIG_ADAFRUIT_SSD1306_FRAME_RATE)
+
+// Schedule the frame flush for the next frame slot, unless one is pending
+static void _frame_schedule(void)
+{
+  int64_t now = k_uptime_get();
+  int64_t delay = display_data.frame_last + FRAME_PERIOD_MS - now;
+
+  display_data.frame_pending = true;
+  k_work_schedule(&display_data.frame_work, K_MSEC(max(delay, 0)));
+}
+
+// Work out the rate over the last second or more.  Also called when the
+// stats are read, so the rate falls to zero once frames stop going out.
+static void _frame_rate_update(int64_t now)
+{
+  int64_t elapsed = now - display_data.frame_window_start;
+
+  if (elapsed >= 1000) {
+    display_data.frame_stats.fps_x100 = display_data.frame_window_count * 100000 / elapsed;
+    display_data.frame_window_start = now;
+    display_data.frame_window_count = 0;
+  }
+}
+
+// The dirty rectangle is kept in logical coordinates and only mapped to
+// the panel here, so a rotation or scroll between the request and the
+// flush sends the rows the rectangle now covers.
+static void _frame_work_handler(struct k_work *work)
+{
+  int ret;
+
+  k_mutex_lock(&display_data.lock, K_FOREVER);
+
+  if (display_data.frame_pending) {
+    display_data.frame_pending = false;
+
+    if (display_data.frame_full) {
+      ret = adafruit_gfx_display();
+    } else {
+      ret = adafruit_gfx_displayRegion(display_data.dirty_x0, display_data.dirty_y0,
+                                       display_data.dirty_x1 - display_data.dirty_x0 + 1,
+                                       display_data.dirty_y1 - display_data.dirty_y0 + 1);
+    }
+
+    int64_t now = k_uptime_get();
+    display_data.frame_last = now;
+    if (ret == 0) {
+      display_data.frame_full = false;
+      display_data.frame_stats.frames++;
+      display_data.frame_window_count++;
+    } else {
+      // Keep what was asked for, later requests merge into it, and try
+      // again a frame period later
+      display_data.frame_stats.errors++;
+      _frame_schedule();
+    }
+
+    _frame_rate_update(now);
+  }
+
+  k_mutex_unlock(&display_data.lock);
+}
+
+// Ask for the whole frame to be sent.  Requests are merged and flushed at
+// most CONFIG_ADAFRUIT_SSD1306_FRAME_RATE times a second from the system
+// work queue, so any number of threads can call this after drawing.
+int adafruit_gfx_request_display(void)
+{
+  k_mutex_lock(&display_data.lock, K_FOREVER);
+
+  display_data.frame_stats.requests++;
+  if (display_data.frame_pending) {
+    display_data.frame_stats.coalesced++;
+  } else {
+    _frame_schedule();
+  }
+  display_data.frame_full = true;
+
+  k_mutex_unlock(&display_data.lock);
+  return 0;
+}
+
+// As adafruit_gfx_request_display(), for a logical rectangle.  Regions
+// requested within one frame period are merged into their bounding box.
+int adafruit_gfx_request_displayRegion(int x, int y, int w, int h)
+{
+  k_mutex_lock(&display_data.lock, K_FOREVER);
+
+  if (!_clip_logical(&x, &y, &w, &h)) {
+    k_mutex_unlock(&display_data.lock);
+    return 0;
+  }
+
+  display_data.frame_stats.requests++;
+  if (display_data.frame_pending) {
+    display_data.frame_stats.coalesced++;
+    display_data.dirty_x0 = min(display_data.dirty_x0, x);
+    display_data.dirty_x1 = max(display_data.dirty_x1, x + w - 1);
+    display_data.dirty_y0 = min(display_data.dirty_y0, y);
+    display_data.dirty_y1 = max(display_data.dirty_y1, y + h - 1);
+  } else {
+    display_data.dirty_x0 = x;
+    display_data.dirty_x1 = x + w - 1;
+    display_data.dirty_y0 = y;
+    display_data.dirty_y1 = y + h - 1;
+    _frame_schedule();
+  }
+
+  k_mutex_unlock(&display_data.lock);
+  return 0;
+}
+
+void adafruit_gfx_frame_stats(struct adafruit_gfx_frame_stats_t *stats, bool reset)
+{
+  k_mutex_lock(&display_data.lock, K_FOREVER);
+
+  _frame_rate_update(k_uptime_get());
+  if (stats) {
+    *stats = display_data.frame_stats;
+  }
+
+  if (reset) {
+    memset(&display_data.frame_stats, 0, sizeof(display_data.frame_stats));
+    display_data.frame_window_start = k_uptime_get();
+    display_data.frame_window_count = 0;
+  }
+
+  k_mutex_unlock(&display_data.lock);
+}
+#endif
+
+// Scroll the whole screen up by 'lines' rows (down if negative) without
+// moving any data: the panel start line is moved and the framebuffer is
+// treated as a ring of rows.  The newly exposed rows are cleared in the
+// framebuffer; draw into them and send them with adafruit_gfx_displayRows().
+// Only rotations 0 and 2 scroll along the panel's rows.
+//
+// The start line wraps around the controller's 64 rows of RAM, so the ring
+// only matches what the panel shows on 64 row panels.  Shorter panels would
+// show RAM pages display() never writes; use adafruit_gfx_scrollRegion().
+// The buffers a scroll moves: the base buffer, then each layer.  Layers
+// are composed at the same RAM address as the base, so they have to move
+// with it whichever one is the drawing target.
+static struct adafruit_gfx_cache_source_t *_scroll_source(int i)
+{
+  if (i == 0) {
+    return &display_data.draw_cache;
+  }
+#ifdef CONFIG_ADAFRUIT_SSD1306_LAYERS
+  if (i <= CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT) {
+    return &display_data.layers[i - 1].source;
+  }
+#endif
+  return NULL;
+}
+
+int adafruit_gfx_scrollVertical(int lines)
+{
+  int raw_lines = lines;
+
+#if defined(CONFIG_ADAFRUIT_SSD1306_STRIP_MODE) || (SSD1306_LCDHEIGHT != 64)
+  return -ENOTSUP;
+#endif
+  if (display_data.rotation & 1) {
+    return -ENOTSUP;
+  }
+
+  lines = clamp(lines, -display_data.raw_height, display_data.raw_height);
+  if (display_data.rotation == 2) {
+    raw_lines = -lines;
+  }
+
+  display_data.start_line = (display_data.start_line + raw_lines +
+                             display_data.raw_height) % display_data.raw_height;
+
+  uint8_t *buf = display_data.buffer;
+  buf[0] = SSD1306_SETSTARTLINE | display_data.start_line;
+  int ret = _bus_write(buf, 1, true);
+  if (ret != 0) {
+    return ret;
+  }
+
+  // The start line moves the composed frame, so the rows exposed are
+  // cleared in the base buffer and in every layer
+  struct adafruit_gfx_cache_source_t *target = display_data.target;
+  struct adafruit_gfx_cache_source_t *source;
+  for (int i = 0; (source = _scroll_source(i)) != NULL; i++) {
+    display_data.target = source;
+    if (lines > 0) {
+      adafruit_gfx_fillRect(0, display_data.height - lines, display_data.width, lines, BLACK);
+    } else if (lines < 0) {
+      adafruit_gfx_fillRect(0, 0, display_data.width, -lines, BLACK);
+    }
+  }
+  display_data.target = target;
+
+  return 0;
+}
+
+static int _read_page_row(int x, int page, int w, uint8_t *buf)
+{
+  while (w > 0) {
+    uint8_t *addr;
+    size_t span;
+
+    int ret = adafruit_gfx_cache_get_span(&display_data.cache, x, page << 3, &addr, &span);
+    if (ret != 0) {
+      return ret;
+    }
+
+    span = min(span, (size_t)w);
+    adafruit_gfx_rop_copy(buf, addr, span);
+    buf += span;
+    x += span;
+    w -= span;
+  }
+
+  return 0;
+}
+
+// Write w bytes into a page row, only changing the bits in mask
+static int _write_page_row(int x, int page, int w, const uint8_t *buf, uint8_t mask)
+{
+  while (w > 0) {
+    uint8_t *addr;
+    size_t span;
+
+    int ret = adafruit_gfx_cache_get_span(&display_data.cache, x, page << 3, &addr, &span);
+    if (ret != 0) {
+      return ret;
+    }
+
+    span = min(span, (size_t)w);
+    adafruit_gfx_rop_blend(addr, buf, span, mask);
+    adafruit_gfx_cache_set_dirty(&display_data.cache, true);
+
+    buf += span;
+    x += span;
+    w -= span;
+  }
+
+  return 0;
+}
+
+// Software scroll of a raw rectangle (positive is up).  Whole pages move a
+// page row at a time and the remaining 0-7 rows are shifted across the page
+// boundaries with the raster-op engine.  Rows outside the rectangle are
+// masked off, the exposed rows are left for the caller to clear.
+static int _scroll_raw_pages(int x, int y, int w, int h, int dy)
+{
+  if (display_data.start_line & 0x07) {
+    return -EINVAL;
+  }
+
+  uint8_t *row = display_data.xfer;
+  uint8_t *next = display_data.xfer_row;
+  int pages = display_data.buf_height >> 3;
+  int first = y >> 3;
+  int last = (y + h - 1) >> 3;
+  int step = (dy > 0) ? 1 : -1;
+  int shift = _abs(dy) >> 3;
+  int bits = _abs(dy) & 0x07;
+  int ret;
+
+  // Walk away from the direction of travel so sources are read before
+  // they are overwritten
+  for (int i = 0; i <= last - first; i++) {
+    int page = (dy > 0) ? first + i : last - i;
+    int src = page + step * shift;
+
+    if (src >= 0 && src < pages) {
+      ret = _read_page_row(x, _ring_page(src), w, row);
+      if (ret != 0) {
+        return ret;
+      }
+    } else {
+      adafruit_gfx_rop_fill(row, w, 0x00);
+    }
+
+    if (bits) {
+      // The rows shifted in come from the next source page
+      const uint8_t *carry = NULL;
+      if (src + step >= 0 && src + step < pages) {
+        ret = _read_page_row(x, _ring_page(src + step), w, next);
+        if (ret != 0) {
+          return ret;
+        }
+        carry = next;
+      }
+
+      if (dy > 0) {
+        adafruit_gfx_rop_shift_up(row, carry, w, bits);
+      } else {
+        adafruit_gfx_rop_shift_down(row, carry, w, bits);
+      }
+    }
+
+    int top = max(y - (page << 3), 0);
+    int bottom = min(y + h - (page << 3), 8);
+    uint8_t mask = (0xFF << top) & (0xFF >> (8 - bottom));
+
+    ret = _write_page_row(x, _ring_page(page), w, row, mask);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+
+  return 0;
+}
+
+// Software scroll of a raw rectangle along the rows (positive is right),
+// a memmove within each page row
+static int _scroll_raw_columns(int x, int y, int w, int h, int dx)
+{
+  uint8_t *row = display_data.xfer;
+  int y_end = y + h;
+
+  if (display_data.start_line & 0x07) {
+    // Rows of a page are split over two RAM pages
+    return -EINVAL;
+  }
+
+  for (int page_y = y & ~0x07; page_y < y_end; page_y += 8) {
+    int top = max(y, page_y) - page_y;
+    int bottom = min(y_end, page_y + 8) - page_y;
+    uint8_t mask = (0xFF << top) & (0xFF >> (8 - bottom));
+    int page = _ring_row(page_y) >> 3;
+
+    int ret = _read_page_row(x, page, w, row);
+    if (ret != 0) {
+      return ret;
+    }
+
+    if (dx > 0) {
+      memmove(&row[dx], row, w - dx);
+    } else {
+      memmove(row, &row[-dx], w + dx);
+    }
+
+    ret = _write_page_row(x, page, w, row, mask);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+
+  return 0;
+}
+
+// Move the logical rectangle (x, y, w, h) of the drawing target up by dy
+// rows and clear the rows exposed
+static int _scroll_target(int x, int y, int w, int h, int dy)
+{
+  int ret;
+
+  if (_abs(dy) >= h) {
+    adafruit_gfx_fillRect(x, y, w, h, BLACK);
+    return 0;
+  }
+
+  int rx = x;
+  int ry = y;
+  int rw = w;
+  int rh = h;
+  _rect_to_buf(&rx, &ry, &rw, &rh);
+
+  ret = adafruit_gfx_cache_source_choose(&display_data.cache, display_data.target);
+  if (ret != 0) {
+    return ret;
+  }
+
+  switch (display_data.buf_rotation) {
+    case 0:
+      ret = _scroll_raw_pages(rx, ry, rw, rh, dy);
+      break;
+    case 1:
+      ret = _scroll_raw_columns(rx, ry, rw, rh, dy);
+      break;
+    case 2:
+      ret = _scroll_raw_pages(rx, ry, rw, rh, -dy);
+      break;
+    case 3:
+      ret = _scroll_raw_columns(rx, ry, rw, rh, -dy);
+      break;
+  }
+  if (ret != 0) {
+    return ret;
+  }
+
+  if (dy > 0) {
+    adafruit_gfx_fillRect(x, y + h - dy, w, dy, BLACK);
+  } else {
+    adafruit_gfx_fillRect(x, y, w, -dy, BLACK);
+  }
+
+  return 0;
+}
+
+// Software scroll of the logical rectangle (x, y, w, h) up by dy rows (down
+// if negative), for regions the hardware start line can't handle.  The
+// rectangle is moved a RAM page row at a time with a bit shift across
+// pages where rows map to pages (rotation 0/2), or with a memmove along
+// each page row at rotation 1/3.  Exposed rows are cleared.  As with
+// scrollVertical the base buffer and every layer move together.
+int adafruit_gfx_scrollRegion(int x, int y, int w, int h, int dy)
+{
+  int ret = 0;
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  // There is no frame to move in strip mode
+  return -ENOTSUP;
+#endif
+
+  if (!_clip_logical(&x, &y, &w, &h) || dy == 0) {
+    return 0;
+  }
+
+  struct adafruit_gfx_cache_source_t *target = display_data.target;
+  struct adafruit_gfx_cache_source_t *source;
+  for (int i = 0; ret == 0 && (source = _scroll_source(i)) != NULL; i++) {
+    display_data.target = source;
+    ret = _scroll_target(x, y, w, h, dy);
+  }
+  display_data.target = target;
+
+  return ret;
+}
+
+// RAM columns and pages holding the logical rectangle (x, y, w, h), widened
+// to whole pages.  The pages are counted from 'page' and wrap around the
+// row ring.
+static bool _region_bounds(int x, int y, int w, int h, int *col, int *cols,
+                           int *page, int *pages)
+{
+  if (!_clip_logical(&x, &y, &w, &h)) {
+    return false;
+  }
+  _rect_to_buf(&x, &y, &w, &h);
+
+  int row = _ring_row(y);
+  *col = x;
+  *cols = w;
+  *page = row >> 3;
+  *pages = min(((row & 0x07) + h + 7) >> 3, display_data.buf_height >> 3);
+  return true;
+}
+
+// Bytes needed to save the logical rectangle (x, y, w, h)
+size_t adafruit_gfx_regionSize(int x, int y, int w, int h)
+{
+  int col, cols, page, pages;
+
+  if (!_region_bounds(x, y, w, h, &col, &cols, &page, &pages)) {
+    return 0;
+  }
+  return cols * pages;
+}
+
+// Snapshot the logical rectangle (x, y, w, h) of the current drawing target,
+// widened to whole pages, so it can be put back after a popup is dismissed.
+// The bytes go into buf if given (at least adafruit_gfx_regionSize() long),
+// otherwise into the region pool.  Each page row is one bulk copy, read
+// straight from the external RAM when the cache is enabled.
+int adafruit_gfx_saveRegion(struct adafruit_gfx_region_t *region, int x, int y, int w, int h,
+                            uint8_t *buf, size_t len)
+{
+  int col, cols, page, pages;
+
+  if (!region) {
+    return -EINVAL;
+  }
+  region->data = NULL;
+  region->pages = 0;
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  return -ENOTSUP;
+#endif
+
+  if (!_region_bounds(x, y, w, h, &col, &cols, &page, &pages)) {
+    return -EINVAL;
+  }
+
+  size_t size = cols * pages;
+  region->pooled = false;
+  if (buf) {
+    if (len < size) {
+      return -ENOMEM;
+    }
+  } else {
+#if CONFIG_ADAFRUIT_SSD1306_REGION_POOL_SIZE > 0
+    buf = k_heap_alloc(&region_pool, size, K_NO_WAIT);
+#endif
+    if (!buf) {
+      return -ENOMEM;
+    }
+    region->pooled = true;
+  }
+
+  region->data = buf;
+  region->source = display_data.target;
+  region->col = col;
+  region->cols = cols;
+  region->page = page;
+  region->pages = pages;
+
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, display_data.target);
+  for (int i = 0; ret == 0 && i < pages; i++) {
+    int p = (page + i) % (display_data.buf_height >> 3);
+    ret = adafruit_gfx_cache_read(&display_data.cache, col, p << 3, &buf[i * cols], cols);
+  }
+
+  if (ret != 0) {
+    adafruit_gfx_releaseRegion(region);
+  }
+  return ret;
+}
+
+// Put a saved region back where it came from.  The region stays valid, so
+// it can be restored again until it is released.  Vertical scrolling in
+// between moves the screen away from the saved RAM rows.
+int adafruit_gfx_restoreRegion(struct adafruit_gfx_region_t *region)
+{
+  if (!region || !region->data) {
+    return -EINVAL;
+  }
+
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, region->source);
+  for (int i = 0; ret == 0 && i < region->pages; i++) {
+    int p = (region->page + i) % (display_data.buf_height >> 3);
+    ret = adafruit_gfx_cache_write(&display_data.cache, region->col, p << 3,
+                                   &region->data[i * region->cols], region->cols);
+  }
+
+  return ret;
+}
+
+// Put back only the part of a saved region inside the logical rectangle
+// (x, y, w, h), leaving the rest of its whole pages as they are now.  The
+// rectangle should lie within the one that was saved.
+int adafruit_gfx_restoreRegionRect(struct adafruit_gfx_region_t *region, int x, int y,
+                                   int w, int h)
+{
+  if (!region || !region->data) {
+    return -EINVAL;
+  }
+  if (!_clip_logical(&x, &y, &w, &h)) {
+    return 0;
+  }
+  _rect_to_buf(&x, &y, &w, &h);
+
+  // Rows counted from the top of the region's first page
+  int row = _ring_row(y) - (region->page << 3);
+  if (row < 0) {
+    row += display_data.buf_height;
+  }
+  int col0 = max(x, region->col);
+  int col1 = min(x + w, region->col + region->cols);
+  if (col0 >= col1) {
+    return 0;
+  }
+
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, region->source);
+  for (int i = 0; ret == 0 && i < region->pages; i++) {
+    int p = (region->page + i) % (display_data.buf_height >> 3);
+    uint8_t mask = _rows_page_mask(i, row, h);
+    const uint8_t *data = &region->data[i * region->cols];
+
+    if (mask == 0xFF) {
+      ret = adafruit_gfx_cache_write(&display_data.cache, col0, p << 3,
+                                     &data[col0 - region->col], col1 - col0);
+      continue;
+    }
+
+    for (int c = col0; mask && c < col1; c++) {
+      uint8_t *addr;
+
+      ret = adafruit_gfx_cache_get_pixel_addr(&display_data.cache, c, p << 3, &addr);
+      if (ret != 0) {
+        break;
+      }
+      *addr = (*addr & ~mask) | (data[c - region->col] & mask);
+      adafruit_gfx_cache_set_dirty(&display_data.cache, true);
+    }
+  }
+
+  return ret;
+}
+
+// Give a pooled region's memory back, caller supplied buffers are just
+// forgotten
+void adafruit_gfx_releaseRegion(struct adafruit_gfx_region_t *region)
+{
+  if (!region || !region->data) {
+    return;
+  }
+
+#if CONFIG_ADAFRUIT_SSD1306_REGION_POOL_SIZE > 0
+  if (region->pooled) {
+    k_heap_free(&region_pool, region->data);
+  }
+#endif
+  region->data = NULL;
+  region->pages = 0;
+}
+
+// clear everything
+void adafruit_gfx_clearDisplay(void) {
+  display_data.show_logo = false;
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  _strip_reset(_target_inverted() ? 0xFF : 0x00);
+  return;
+#endif
+  
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, display_data.target);
+  if (ret == 0) {
+    adafruit_gfx_cache_fill_all(&display_data.cache, _target_inverted() ? 0xFF : 0x00);
+  }
+}
+
+// Invert the whole panel with a single command, effective immediately.
+// The buffer is left alone; while inverted the drawing kernels complement
+// WHITE and BLACK so everything keeps drawing in its normal color.
+int adafruit_gfx_invertDisplay(bool invert)
+{
+  if (invert == display_data.inverted) {
+    return 0;
+  }
+
+  display_data.buffer[0] = invert ? SSD1306_INVERTDISPLAY : SSD1306_NORMALDISPLAY;
+  int ret = _bus_write(display_data.buffer, 1, true);
+  if (ret != 0) {
+    return ret;
+  }
+
+  display_data.inverted = invert;
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  _strip_state();
+#endif
+  return 0;
+}
+
+bool adafruit_gfx_isInverted(void)
+{
+  return display_data.inverted;
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_LAYERS
+static struct adafruit_gfx_layer_t *_layer(int layer)
+{
+  if (layer < 1 || layer > CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT) {
+    return NULL;
+  }
+  return &display_data.layers[layer - 1];
+}
+
+// Direct all drawing (including clearDisplay) at a layer, or
+// back at the base buffer with GFX_LAYER_BASE.  Layers are composed on top
+// of the base buffer in order while the frame is sent, so content that
+// doesn't change is drawn into a layer once and left alone.  Scrolling
+// moves the base buffer and every layer whatever the target.
+int adafruit_gfx_setLayer(int layer)
+{
+  if (layer == GFX_LAYER_BASE) {
+    display_data.target = &display_data.draw_cache;
+    return 0;
+  }
+
+  struct adafruit_gfx_layer_t *l = _layer(layer);
+  if (!l) {
+    return -EINVAL;
+  }
+
+  display_data.target = &l->source;
+  return 0;
+}
+
+int adafruit_gfx_getLayer(void)
+{
+  for (int i = 0; i < CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT; i++) {
+    if (display_data.target == &display_data.layers[i].source) {
+      return i + 1;
+    }
+  }
+  return GFX_LAYER_BASE;
+}
+
+int adafruit_gfx_showLayer(int layer, bool visible)
+{
+  struct adafruit_gfx_layer_t *l = _layer(layer);
+  if (!l) {
+    return -EINVAL;
+  }
+
+  l->visible = visible;
+  return 0;
+}
+
+// How a layer's set pixels combine with what is below: GFX_LAYER_OR lights
+// them, GFX_LAYER_XOR toggles them and GFX_LAYER_MASK blanks them
+int adafruit_gfx_setLayerMode(int layer, int mode)
+{
+  struct adafruit_gfx_layer_t *l = _layer(layer);
+  if (!l || (mode != GFX_LAYER_OR && mode != GFX_LAYER_XOR && mode != GFX_LAYER_MASK)) {
+    return -EINVAL;
+  }
+
+  l->mode = mode;
+  return 0;
+}
+#endif
+
+// the most basic function, set a single pixel
+void adafruit_gfx_drawPixel(int x, int y, int color)
+{
+  if ((x < display_data.clip_x0) || (x >= display_data.clip_x1) ||
+      (y < display_data.clip_y0) || (y >= display_data.clip_y1))
+    return;
+  if (STRIP_RECORD(STRIP_OP_PIXEL, NULL, NULL, x, y, color)) {
+    return;
+  }
+
+  _drawPixelInternal(x, y, color);
+}
+
+// Set a logical pixel the caller has already clipped
+static void _drawPixelInternal(int x, int y, int color)
+{
+  // check rotation, move pixel around if necessary
+  switch (display_data.buf_rotation) {
+  case 1:
+    _swap_int(x, y);
+    x = display_data.buf_width - x - 1;
+    break;
+  case 2:
+    x = display_data.buf_width - x - 1;
+    y = display_data.buf_height - y - 1;
+    break;
+  case 3:
+    _swap_int(x, y);
+    y = display_data.buf_height - y - 1;
+    break;
+  }
+
+  y = _ring_row(y);
+  _draw_pixels_masked(x, y, color, SSD1306_PIXEL_MASK(y));
+}
+
+
+void adafruit_gfx_drawFastHLine(int x, int y, int w, int color) 
+{
+  LATENCY_PRIMITIVE(GFX_LATENCY_LINE);
+
+  int h = 1;
+  if (!_clip_rect(&x, &y, &w, &h)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_HLINE, NULL, NULL, x, y, w, color)) {
+    return;
+  }
+
+  int bSwap = 0;
+  switch(display_data.buf_rotation) {
+    case 0:
+      // 0 degree rotation, do nothing
+      break;
+    case 1:
+      // 90 degree rotation, swap x & y for rotation, then invert x
+      bSwap = 1;
+      _swap_int(x, y);
+      x = display_data.buf_width - x - 1;
+      break;
+    case 2:
+      // 180 degree rotation, invert x and y - then shift y around for height.
+      x = display_data.buf_width - x - 1;
+      y = display_data.buf_height - y - 1;
+      x -= (w-1);
+      break;
+    case 3:
+      // 270 degree rotation, swap x & y for rotation, then invert y  and adjust y for w (not to become h)
+      bSwap = 1;
+      _swap_int(x, y);
+      y = display_data.buf_height - y - 1;
+      y -= (w-1);
+      break;
+  }
+
+  if(bSwap) {
+    _drawFastVLineInternal(x, y, w, color);
+  } else {
+    _drawFastHLineInternal(x, y, w, color);
+  }
+}
+
+static void _drawFastHLineInternal(int x, int y, int w, int color) 
+{
+  // A horizontal line is a one row high rectangle, which the page fill
+  // handles a whole cache line at a time
+  _fillRectInternal(x, y, w, 1, color);
+}
+
+void adafruit_gfx_drawFastVLine(int x, int y, int h, int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_LINE);
+
+  int w = 1;
+  if (!_clip_rect(&x, &y, &w, &h)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_VLINE, NULL, NULL, x, y, h, color)) {
+    return;
+  }
+
+  int bSwap = 0;
+  switch(display_data.buf_rotation) {
+    case 0:
+      break;
+    case 1:
+      // 90 degree rotation, swap x & y for rotation, then invert x and adjust x for h (now to become w)
       bSwap = 1;
       _swap_int(x, y);
-      x = display_data.raw_width - x - 1;
+      x = display_data.buf_width - x - 1;
       x -= (h-1);
       break;
     case 2:
       // 180 degree rotation, invert x and y - then shift y around for height.
-      x = display_data.raw_width - x - 1;
-      y = display_data.raw_height - y - 1;
+      x = display_data.buf_width - x - 1;
+      y = display_data.buf_height - y - 1;
       y -= (h-1);
       break;
     case 3:
       // 270 degree rotation, swap x & y for rotation, then invert y
       bSwap = 1;
       _swap_int(x, y);
-      y = display_data.raw_height - y - 1;
+      y = display_data.buf_height - y - 1;
       break;
   }
 
@@ -428,10 +2206,8 @@ static const uint8_t postmask[8] = { 0x00, 0x01, 0x03, 0x07, 0x0F, 0x1F, 0x3F, 0
 
 static void _drawFastVLineInternal(int x, int y, int h, int color) 
 {
-  int ret = 0;
-
   // do nothing if we're off the left or right side of the screen
-  if (x < 0 || x >= display_data.raw_width) {
+  if (x < 0 || x >= display_data.buf_width) {
     return;
   }
 
@@ -443,8 +2219,8 @@ static void _drawFastVLineInternal(int x, int y, int h, int color)
   }
 
   // make sure we don't go past the height of the display
-  if (y + h > display_data.raw_height) {
-    h = display_data.raw_height - y;
+  if (y + h > display_data.buf_height) {
+    h = display_data.buf_height - y;
   }
 
   // if our height is now negative, punt
@@ -452,6 +2228,25 @@ static void _drawFastVLineInternal(int x, int y, int h, int color)
     return;
   }
 
+  // split the span where it wraps around the row ring
+  y = _ring_row(y);
+  if (y + h > display_data.buf_height) {
+    int first = display_data.buf_height - y;
+    _drawVSpan(x, y, first, color);
+    _drawVSpan(x, 0, h - first, color);
+  } else {
+    _drawVSpan(x, y, h, color);
+  }
+}
+
+// Draw a clipped vertical span of RAM rows
+static void _drawVSpan(int x, int y, int h, int color)
+{
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, display_data.target);
+  if (ret != 0) {
+    return;
+  }
+
   // do the first partial byte, if necessary - this requires some masking
   register uint8_t mod = (y & 0x07);
   register uint8_t data;
@@ -497,7 +2292,7 @@ static void _drawFastVLineInternal(int x, int y, int h, int color)
       } while (h >= 8);
     } else {
       // store a local value to work with
-      data = (color == WHITE) ? 0xFF : 0;
+      data = (_raster_color(color) == WHITE) ? 0xFF : 0;
       uint8_t *addr;
 
       do  {
@@ -507,7 +2302,7 @@ static void _drawFastVLineInternal(int x, int y, int h, int color)
         }
     
       	*addr = data;
-      	display_data.cache.dirty = true;
+      	adafruit_gfx_cache_set_dirty(&display_data.cache, true);
 
         // adjust h & y (there's got to be a faster way for me to do this, but
         // this should still help a fair bit for now)
@@ -530,12 +2325,12 @@ static int _draw_pixels_masked(int x, int y, int color, uint8_t mask)
       return 0;
     }
     
-    int ret = adafruit_gfx_cache_source_choose(&display_data.cache, &display_data.draw_cache);
+    int ret = adafruit_gfx_cache_source_choose(&display_data.cache, display_data.target);
     if (ret != 0) {
       return ret;
     }
 
-    switch (color)
+    switch (_raster_color(color))
     {
       case WHITE:
         adafruit_gfx_cache_operCache(&display_data.cache, x, y, SET_BITS, mask);
@@ -560,6 +2355,15 @@ static int _draw_pixels_masked(int x, int y, int color, uint8_t mask)
 // Draw a circle outline
 void adafruit_gfx_drawCircle(int x0, int y0, int r, int color) 
 {
+  LATENCY_PRIMITIVE(GFX_LATENCY_CIRCLE);
+
+  if (_clip_reject(x0 - r, y0 - r, 2 * r + 1, 2 * r + 1)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_CIRCLE, NULL, NULL, x0, y0, r, color)) {
+    return;
+  }
+
   int16_t f = 1 - r;
   int16_t ddF_x = 1;
   int16_t ddF_y = -2 * r;
@@ -594,6 +2398,10 @@ void adafruit_gfx_drawCircle(int x0, int y0, int r, int color)
 
 void adafruit_gfx_drawCircleHelper( int x0, int y0,
  int r, uint8_t cornername, int color) {
+  if (STRIP_RECORD(STRIP_OP_CIRCLE_HELPER, NULL, NULL, x0, y0, r, cornername, color)) {
+    return;
+  }
+
   int16_t f     = 1 - r;
   int16_t ddF_x = 1;
   int16_t ddF_y = -2 * r;
@@ -630,6 +2438,15 @@ void adafruit_gfx_drawCircleHelper( int x0, int y0,
 
 void adafruit_gfx_fillCircle(int x0, int y0, int r,
  int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_CIRCLE);
+
+  if (_clip_reject(x0 - r, y0 - r, 2 * r + 1, 2 * r + 1)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_FILL_CIRCLE, NULL, NULL, x0, y0, r, color)) {
+    return;
+  }
+
   adafruit_gfx_drawFastVLine(x0, y0-r, 2*r+1, color);
   adafruit_gfx_fillCircleHelper(x0, y0, r, 3, 0, color);
 }
@@ -637,6 +2454,9 @@ void adafruit_gfx_fillCircle(int x0, int y0, int r,
 // Used to do circles and roundrects
 void adafruit_gfx_fillCircleHelper(int x0, int y0, int r,
      uint8_t cornername, int delta, int color) {
+  if (STRIP_RECORD(STRIP_OP_FILL_CIRCLE_HELPER, NULL, NULL, x0, y0, r, cornername, delta, color)) {
+    return;
+  }
 
   int16_t f     = 1 - r;
   int16_t ddF_x = 1;
@@ -666,11 +2486,34 @@ void adafruit_gfx_fillCircleHelper(int x0, int y0, int r,
 }
 
 // Bresenham's algorithm - thx wikpedia
+//
+// The line is clipped before it is walked.  Step i of the walk draws
+// (x0 + i, y0 + ystep * k) with k = max(0, ceil((i * dy - dx / 2) / dx)),
+// so the steps inside the clip rectangle, and the error term at the first
+// of them, are worked out directly and only those steps are taken.  The
+// pixels are exactly the ones the unclipped walk would draw.
 void adafruit_gfx_drawLine(int x0, int y0, int x1, int y1, int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_LINE);
+
+  if (_clip_reject(min(x0, x1), min(y0, y1), _abs(x1 - x0) + 1, _abs(y1 - y0) + 1)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_LINE, NULL, NULL, x0, y0, x1, y1, color)) {
+    return;
+  }
+
+  // Clip rectangle along the stepped axis (u) and the other one (v)
+  int u_min = display_data.clip_x0;
+  int u_max = display_data.clip_x1 - 1;
+  int v_min = display_data.clip_y0;
+  int v_max = display_data.clip_y1 - 1;
+
   int16_t steep = _abs(y1 - y0) > _abs(x1 - x0);
   if (steep) {
     _swap_int(x0, y0);
     _swap_int(x1, y1);
+    _swap_int(u_min, v_min);
+    _swap_int(u_max, v_max);
   }
 
   if (x0 > x1) {
@@ -678,11 +2521,9 @@ void adafruit_gfx_drawLine(int x0, int y0, int x1, int y1, int color) {
     _swap_int(y0, y1);
   }
 
-  int16_t dx, dy;
-  dx = x1 - x0;
-  dy = _abs(y1 - y0);
-
-  int16_t err = dx / 2;
+  int dx = x1 - x0;
+  int dy = _abs(y1 - y0);
+  int e0 = dx / 2;
   int ystep;
 
   if (y0 < y1) {
@@ -691,15 +2532,51 @@ void adafruit_gfx_drawLine(int x0, int y0, int x1, int y1, int color) {
     ystep = -1;
   }
 
-  for (; x0 <= x1; x0++) {
+  // Steps inside the clip along u
+  int first = max(0, u_min - x0);
+  int last = min(dx, u_max - x0);
+
+  // Rows (counted from y0 in the direction of ystep) inside the clip
+  int k_min = (ystep > 0) ? v_min - y0 : y0 - v_max;
+  int k_max = (ystep > 0) ? v_max - y0 : y0 - v_min;
+  if (k_max < 0 || k_min > dy) {
+    return;
+  }
+
+  if (dy == 0) {
+    if (k_min > 0) {
+      return;
+    }
+  } else {
+    // k_i >= k_min  <=>  i * dy > e0 + (k_min - 1) * dx
+    // k_i <= k_max  <=>  i * dy <= e0 + k_max * dx
+    if (k_min > 0) {
+      first = max(first, (int)((e0 + (int64_t)(k_min - 1) * dx) / dy) + 1);
+    }
+    last = min(last, (int)((e0 + (int64_t)k_max * dx) / dy));
+  }
+  if (first > last) {
+    return;
+  }
+
+  // Row and error term as the walk would have them at step first
+  int k = 0;
+  if (dy != 0 && (int64_t)first * dy > e0) {
+    k = ((int64_t)first * dy - e0 + dx - 1) / dx;
+  }
+  int err = e0 - (int64_t)first * dy + (int64_t)k * dx;
+  int x = x0 + first;
+  int y = y0 + ystep * k;
+
+  for (int i = first; i <= last; i++, x++) {
     if (steep) {
-      adafruit_gfx_drawPixel(y0, x0, color);
+      _drawPixelInternal(y, x, color);
     } else {
-      adafruit_gfx_drawPixel(x0, y0, color);
+      _drawPixelInternal(x, y, color);
     }
     err -= dy;
     if (err < 0) {
-      y0 += ystep;
+      y += ystep;
       err += dx;
     }
   }
@@ -707,25 +2584,194 @@ void adafruit_gfx_drawLine(int x0, int y0, int x1, int y1, int color) {
 
 // Draw a rectangle
 void adafruit_gfx_drawRect(int x, int y, int w, int h, int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_RECT);
+
+  if (STRIP_RECORD(STRIP_OP_RECT, NULL, NULL, x, y, w, h, color)) {
+    return;
+  }
+
   adafruit_gfx_drawFastHLine(x, y, w, color);
   adafruit_gfx_drawFastHLine(x, y+h-1, w, color);
   adafruit_gfx_drawFastVLine(x, y, h, color);
   adafruit_gfx_drawFastVLine(x+w-1, y, h, color);
 }
 
+// Map a logical rectangle through a rotation onto a width x height
+// rotation 0 layout
+static void _rect_rotate(int rotation, int width, int height, int *x, int *y, int *w, int *h)
+{
+  int rx = *x;
+  int ry = *y;
+  int rw = *w;
+  int rh = *h;
+
+  switch (rotation) {
+    case 1:
+      rx = width - *y - *h;
+      ry = *x;
+      rw = *h;
+      rh = *w;
+      break;
+    case 2:
+      rx = width - *x - *w;
+      ry = height - *y - *h;
+      break;
+    case 3:
+      rx = *y;
+      ry = height - *x - *w;
+      rw = *h;
+      rh = *w;
+      break;
+  }
+
+  *x = rx;
+  *y = ry;
+  *w = rw;
+  *h = rh;
+}
+
+// Map a logical rectangle to the raw (rotation 0) rectangle it covers on
+// the panel
+static void _rect_to_raw(int *x, int *y, int *w, int *h)
+{
+  _rect_rotate(display_data.rotation, display_data.raw_width, display_data.raw_height,
+               x, y, w, h);
+}
+
+// Map a logical rectangle to the rectangle it covers in the draw buffer
+static void _rect_to_buf(int *x, int *y, int *w, int *h)
+{
+  _rect_rotate(display_data.buf_rotation, display_data.buf_width, display_data.buf_height,
+               x, y, w, h);
+}
+
+// Fill a raw rectangle a page at a time.  Every byte in a page row gets the
+// same mask, so each row is one pass over contiguous cache line bytes.
+static void _fillRectInternal(int x, int y, int w, int h, int color)
+{
+  // Clip to the raw display
+  if (x < 0) {
+    w += x;
+    x = 0;
+  }
+  if (y < 0) {
+    h += y;
+    y = 0;
+  }
+  w = min(w, display_data.buf_width - x);
+  h = min(h, display_data.buf_height - y);
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+
+  y = _ring_row(y);
+  if (y + h > display_data.buf_height) {
+    int first = display_data.buf_height - y;
+    _fillRawRows(x, y, w, first, color);
+    _fillRawRows(x, 0, w, h - first, color);
+  } else {
+    _fillRawRows(x, y, w, h, color);
+  }
+}
+
+// Fill clipped RAM rows, see _fillRectInternal()
+static void _fillRawRows(int x, int y, int w, int h, int color)
+{
+  if (color != WHITE && color != BLACK && color != INVERSE) {
+    return;
+  }
+
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, display_data.target);
+  if (ret != 0) {
+    return;
+  }
+
+  color = _raster_color(color);
+  int y_end = y + h;
+  for (int page_y = y & ~0x07; page_y < y_end; page_y += 8) {
+    int top = max(y, page_y) - page_y;
+    int bottom = min(y_end, page_y + 8) - page_y;
+    uint8_t mask = (0xFF << top) & (0xFF >> (8 - bottom));
+
+    // The same raster op covers every byte of the page row
+    rop_t rop = ROP_XOR;
+    uint8_t value = mask;
+    if (color == WHITE) {
+      rop = (mask == 0xFF) ? ROP_COPY : ROP_OR;
+    } else if (color == BLACK) {
+      rop = (mask == 0xFF) ? ROP_COPY : ROP_ANDNOT;
+      value = (mask == 0xFF) ? 0x00 : mask;
+    }
+
+    int col = x;
+    int remaining = w;
+    while (remaining > 0) {
+      uint8_t *addr;
+      size_t span;
+
+      ret = adafruit_gfx_cache_get_span(&display_data.cache, col, page_y, &addr, &span);
+      if (ret != 0) {
+        return;
+      }
+
+      int n = min((int)span, remaining);
+      adafruit_gfx_rop_apply(addr, n, rop, value);
+      adafruit_gfx_cache_set_dirty(&display_data.cache, true);
+
+      col += n;
+      remaining -= n;
+    }
+  }
+}
+
 void adafruit_gfx_fillRect(int x, int y, int w, int h, int color) {
-  // Update in subclasses if desired!
-  for (int16_t i = x; i < x + w; i++) {
-    adafruit_gfx_drawFastVLine(i, y, h, color);
+  LATENCY_PRIMITIVE(GFX_LATENCY_RECT);
+
+  if (!_clip_rect(&x, &y, &w, &h)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_FILL_RECT, NULL, NULL, x, y, w, h, color)) {
+    return;
   }
+
+  _rect_to_buf(&x, &y, &w, &h);
+  _fillRectInternal(x, y, w, h, color);
 }
 
-void adafruit_gfx_fillScreen(int color) {
+void adafruit_gfx_fillScreen(int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_RECT);
+
+  // Inverting everything is one panel command, the buffer isn't touched.
+  // Only possible while drawing into the base buffer with no layer shown.
+  if (color == INVERSE && display_data.target == &display_data.draw_cache &&
+      !_layers_visible() &&
+      display_data.clip_x0 == 0 && display_data.clip_y0 == 0 &&
+      display_data.clip_x1 == display_data.width && display_data.clip_y1 == display_data.height) {
+    adafruit_gfx_invertDisplay(!display_data.inverted);
+    return;
+  }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  // Covering the whole screen makes everything recorded so far invisible
+  if ((color == WHITE || color == BLACK) && !display_data.strip_replaying &&
+      display_data.clip_x0 == 0 && display_data.clip_y0 == 0 &&
+      display_data.clip_x1 == display_data.width && display_data.clip_y1 == display_data.height) {
+    _strip_reset(_raster_color(color) == WHITE ? 0xFF : 0x00);
+    return;
+  }
+#endif
+
   adafruit_gfx_fillRect(0, 0, display_data.width, display_data.height, color);
 }
 
 // Draw a rounded rectangle
 void adafruit_gfx_drawRoundRect(int x, int y, int w, int h, int r, int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_RECT);
+
+  if (STRIP_RECORD(STRIP_OP_ROUND_RECT, NULL, NULL, x, y, w, h, r, color)) {
+    return;
+  }
+
   // smarter version
   adafruit_gfx_drawFastHLine(x+r  , y    , w-2*r, color); // Top
   adafruit_gfx_drawFastHLine(x+r  , y+h-1, w-2*r, color); // Bottom
@@ -741,6 +2787,12 @@ void adafruit_gfx_drawRoundRect(int x, int y, int w, int h, int r, int color) {
 // Fill a rounded rectangle
 void adafruit_gfx_fillRoundRect(int x, int y, int w,
  int h, int r, int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_RECT);
+
+  if (STRIP_RECORD(STRIP_OP_FILL_ROUND_RECT, NULL, NULL, x, y, w, h, r, color)) {
+    return;
+  }
+
   // smarter version
   adafruit_gfx_fillRect(x+r, y, w-2*r, h, color);
 
@@ -752,6 +2804,12 @@ void adafruit_gfx_fillRoundRect(int x, int y, int w,
 // Draw a triangle
 void adafruit_gfx_drawTriangle(int x0, int y0,
  int x1, int y1, int x2, int y2, int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_TRIANGLE);
+
+  if (STRIP_RECORD(STRIP_OP_TRIANGLE, NULL, NULL, x0, y0, x1, y1, x2, y2, color)) {
+    return;
+  }
+
   adafruit_gfx_drawLine(x0, y0, x1, y1, color);
   adafruit_gfx_drawLine(x1, y1, x2, y2, color);
   adafruit_gfx_drawLine(x2, y2, x0, y0, color);
@@ -760,6 +2818,11 @@ void adafruit_gfx_drawTriangle(int x0, int y0,
 // Fill a triangle
 void adafruit_gfx_fillTriangle(int x0, int y0,
  int x1, int y1, int x2, int y2, int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_TRIANGLE);
+
+  if (STRIP_RECORD(STRIP_OP_FILL_TRIANGLE, NULL, NULL, x0, y0, x1, y1, x2, y2, color)) {
+    return;
+  }
 
   int16_t a, b, y, last;
 
@@ -835,78 +2898,661 @@ void adafruit_gfx_fillTriangle(int x0, int y0,
   }
 }
 
-// Draw a 1-bit image (bitmap) at the specified (x,y) position from the
-// provided bitmap buffer using the specified foreground (for set bits)
-// and background (for clear bits) colors.
-// If foreground and background are the same, unset bits are transparent
-void adafruit_gfx_drawBitmap(int x, int y, uint8_t *bitmap, int w, int h, int color, int bg) 
+// Draw a 1-bit image (bitmap) at the specified (x,y) position from the
+// provided bitmap buffer using the specified foreground (for set bits)
+// and background (for clear bits) colors.
+// If foreground and background are the same, unset bits are transparent
+void adafruit_gfx_drawBitmap(int x, int y, uint8_t *bitmap, int w, int h, int color, int bg) 
+{
+  LATENCY_PRIMITIVE(GFX_LATENCY_BITMAP);
+
+  int i, j, byteWidth = (w + 7) / 8;
+  int cx = x, cy = y, cw = w, ch = h;
+
+  // Only walk the part of the bitmap inside the clip
+  if (!_clip_rect(&cx, &cy, &cw, &ch)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_BITMAP, bitmap, NULL, x, y, w, h, color, bg)) {
+    return;
+  }
+
+  for(j=cy-y; j<cy-y+ch; j++) {
+    const uint8_t *row = &bitmap[j * byteWidth];
+    for(i=cx-x; i<cx-x+cw; i++ ) {
+      if(row[i >> 3] & (0x80 >> (i & 7))) {
+        _drawPixelInternal(x+i, y+j, color);
+      } else if(color != bg) {
+        _drawPixelInternal(x+i, y+j, bg);
+      }
+    }
+  }
+}
+
+//Draw XBitMap Files (*.xbm), exported from GIMP,
+//Usage: Export from GIMP to *.xbm, rename *.xbm to *.c and open in editor.
+//C Array can be directly used with this function
+void adafruit_gfx_drawXBitmap(int x, int y,
+ const uint8_t *bitmap, int w, int h, int color) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_BITMAP);
+
+  int i, j, byteWidth = (w + 7) / 8;
+  int cx = x, cy = y, cw = w, ch = h;
+
+  if (!_clip_rect(&cx, &cy, &cw, &ch)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_XBITMAP, bitmap, NULL, x, y, w, h, color)) {
+    return;
+  }
+
+  for(j=cy-y; j<cy-y+ch; j++) {
+    const uint8_t *row = &bitmap[j * byteWidth];
+    for(i=cx-x; i<cx-x+cw; i++ ) {
+      if(row[i >> 3] & (0x01 << (i & 7))) {
+        _drawPixelInternal(x+i, y+j, color);
+      }
+    }
+  }
+}
+
+// Copy len decoded image bytes into page 'page' starting at raw column x.
+// The decoder writes straight into the cache line, one line at a time.
+static int _image_copy_span(struct adafruit_gfx_image_decoder_t *dec, int x, int page, int len)
+{
+  uint8_t *addr;
+  size_t span;
+
+  while (len > 0) {
+    int ret = adafruit_gfx_cache_get_span(&display_data.cache, x, page << 3, &addr, &span);
+    if (ret != 0) {
+      return ret;
+    }
+
+    span = min(span, (size_t)len);
+    if (adafruit_gfx_image_decode(dec, addr, span) != span) {
+      return -EINVAL;
+    }
+    if (_target_inverted()) {
+      adafruit_gfx_rop_invert(addr, span);
+    }
+    adafruit_gfx_cache_set_dirty(&display_data.cache, true);
+
+    x += span;
+    len -= span;
+  }
+
+  return 0;
+}
+
+// Rows y to y + h - 1 that lie in page 'page', as a page byte mask
+static uint8_t _rows_page_mask(int page, int y, int h)
+{
+  int top = max(y - page * 8, 0);
+  int bottom = min(y + h - page * 8, 8);
+
+  if (top >= bottom) {
+    return 0;
+  }
+  return (0xFF << top) & (0xFF >> (8 - bottom));
+}
+
+#ifndef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+// Draw a source page byte shifted down into buffer pages page and page + 1
+static int _blit_page_bits(int x, int page, int color, uint16_t bits, uint8_t mask0,
+      uint8_t mask1)
+{
+  int ret = 0;
+
+  if (bits & mask0) {
+    ret = _draw_pixels_masked(x, _ring_row(page << 3), color, bits & mask0);
+  }
+  if (((bits >> 8) & mask1) && ret == 0) {
+    ret = _draw_pixels_masked(x, _ring_row((page + 1) << 3), color, (bits >> 8) & mask1);
+  }
+
+  return ret;
+}
+
+// Blit page-format bits covering the buffer rectangle (rx, ry, rw, rh), rw
+// bytes per page, only touching the buffer rectangle (cx, cy, cw, ch) inside
+// it.  Set bits are drawn in color and, if bg differs, clear bits in bg.
+// With a mask (same layout as src) only the pixels it sets are drawn.
+static int _blitPages(int rx, int ry, int rw, int rh, const uint8_t *src, const uint8_t *mask,
+      int cx, int cy, int cw, int ch, int color, int bg)
+{
+  int ret = 0;
+
+  for (int p = 0; p < (rh + 7) >> 3 && ret == 0; p++) {
+    int top = ry + (p << 3);
+    if (top + 8 <= cy || top >= cy + ch) {
+      continue;
+    }
+
+    // The source page straddles two buffer pages unless top is aligned
+    int page = top >> 3;
+    int shift = top & 0x07;
+    uint8_t mask0 = _rows_page_mask(page, cy, ch);
+    uint8_t mask1 = _rows_page_mask(page + 1, cy, ch);
+    const uint8_t *s = &src[p * rw + (cx - rx)];
+    const uint8_t *m = mask ? &mask[p * rw + (cx - rx)] : NULL;
+
+    for (int x = cx; x < cx + cw && ret == 0; x++) {
+      uint16_t bits = *s++ << shift;
+      uint16_t fill = (m ? *m++ : 0xFF) << shift;
+
+      ret = _blit_page_bits(x, page, color, bits & fill, mask0, mask1);
+      if (bg != color && ret == 0) {
+        ret = _blit_page_bits(x, page, bg, ~bits & fill, mask0, mask1);
+      }
+    }
+  }
+
+  return ret;
+}
+#endif
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+// Bytes in the page-format copy of a w x h asset turned for buffer rotation r
+static size_t _rotated_size(int w, int h, int r)
+{
+  return ((r & 1) ? h : w) * ((((r & 1) ? w : h) + 7) >> 3);
+}
+
+// Set pixel (gx, gy) of a w x h asset in its page-format copy turned for
+// buffer rotation r, the way _rect_to_buf() turns the rectangle
+static void _rotate_pages_set(uint8_t *pages, int r, int w, int h, int gx, int gy)
+{
+  int u, v;
+
+  switch (r) {
+    case 1:
+      u = h - 1 - gy;
+      v = gx;
+      break;
+    case 2:
+      u = w - 1 - gx;
+      v = h - 1 - gy;
+      break;
+    case 3:
+      u = gy;
+      v = w - 1 - gx;
+      break;
+    default:
+      u = gx;
+      v = gy;
+      break;
+  }
+
+  pages[(v >> 3) * ((r & 1) ? h : w) + u] |= 1 << (v & 0x07);
+}
+#endif
+
+// Merge the bits of one buffer byte under mask, which is already clipped
+static void _image_merge_byte(int x, int page, uint8_t bits, uint8_t mask)
+{
+  uint8_t *addr;
+
+  if (!mask) {
+    return;
+  }
+  if (_target_inverted()) {
+    bits = ~bits;
+  }
+
+  page = _ring_page(page);
+  if (adafruit_gfx_cache_get_pixel_addr(&display_data.cache, x, page << 3, &addr) != 0) {
+    return;
+  }
+
+  *addr = (*addr & ~mask) | (bits & mask);
+  adafruit_gfx_cache_set_dirty(&display_data.cache, true);
+}
+
+// Without a page-format copy that matches the buffer rotation, go pixel by
+// pixel over the part of the image inside the clip
+static int _drawImageRotated(int x, int y, const GFXimage *img)
+{
+  struct adafruit_gfx_image_decoder_t dec;
+  uint8_t data;
+  int cx = x, cy = y, cw = img->width, ch = img->pages << 3;
+
+  if (!_clip_rect(&cx, &cy, &cw, &ch)) {
+    return 0;
+  }
+
+  adafruit_gfx_image_decoder_init(&dec, img);
+
+  for (int page = 0; page < img->pages; page++) {
+    int top = y + (page << 3);
+    if (top + 8 <= cy || top >= cy + ch) {
+      adafruit_gfx_image_skip(&dec, img->width);
+      continue;
+    }
+
+    adafruit_gfx_image_skip(&dec, cx - x);
+    for (int i = cx - x; i < cx - x + cw; i++) {
+      if (adafruit_gfx_image_decode(&dec, &data, 1) != 1) {
+        return -EINVAL;
+      }
+
+      for (int j = 0; j < 8; j++, data >>= 1) {
+        if (top + j >= cy && top + j < cy + ch) {
+          _drawPixelInternal(x + i, top + j, (data & 0x01) ? WHITE : BLACK);
+        }
+      }
+    }
+    adafruit_gfx_image_skip(&dec, img->width - (cx - x + cw));
+  }
+
+  return 0;
+}
+
+// Decode a page-format image into the draw buffer with its top-left corner
+// at buffer (x, y), only touching the buffer rectangle (cx, cy, cw, ch).
+// Whole visible pages are decoded straight into the cache line.
+static int _drawImagePages(int x, int y, const GFXimage *img, int cx, int cy, int cw, int ch)
+{
+  int ret = adafruit_gfx_cache_source_choose(&display_data.cache, display_data.target);
+  if (ret != 0) {
+    return ret;
+  }
+
+  // Horizontal clipping is the same for every page, vertical clipping is a
+  // mask on the destination page
+  int skip_left = max(cx - x, 0);
+  int visible = min((int)img->width, cx + cw - x) - skip_left;
+  if (visible <= 0) {
+    return 0;
+  }
+  int skip_right = img->width - skip_left - visible;
+  x += skip_left;
+
+  struct adafruit_gfx_image_decoder_t dec;
+  adafruit_gfx_image_decoder_init(&dec, img);
+
+  int shift = y & 0x07;
+  int page = y >> 3;
+  uint8_t chunk[16];
+
+  for (int p = 0; p < img->pages; p++, page++) {
+    adafruit_gfx_image_skip(&dec, skip_left);
+
+    uint8_t mask0 = _rows_page_mask(page, cy, ch);
+    uint8_t mask1 = _rows_page_mask(page + 1, cy, ch);
+
+    if (!shift && mask0 == 0xFF) {
+      ret = _image_copy_span(&dec, x, _ring_page(page), visible);
+      if (ret != 0) {
+        return ret;
+      }
+    } else if (!shift && !mask0) {
+      adafruit_gfx_image_skip(&dec, visible);
+    } else {
+      // Each source byte straddles two destination pages (or one partly
+      // clipped page when there is no shift)
+      for (int i = 0; i < visible; ) {
+        size_t n = adafruit_gfx_image_decode(&dec, chunk, min((int)sizeof(chunk), visible - i));
+        if (n == 0) {
+          return -EINVAL;
+        }
+
+        for (size_t k = 0; k < n; k++, i++) {
+          _image_merge_byte(x + i, page, chunk[k] << shift, (0xFF << shift) & mask0);
+          _image_merge_byte(x + i, page + 1, chunk[k] >> (8 - shift),
+                            (0xFF >> (8 - shift)) & mask1);
+        }
+      }
+    }
+
+    adafruit_gfx_image_skip(&dec, skip_right);
+  }
+
+  return 0;
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+// The image turned for buffer rotation r as raw page bytes, rendered into
+// the arena on first use.  NULL if it doesn't fit.
+static const uint8_t *_image_arena(const GFXimage *img, int r)
+{
+  uint8_t *pages = adafruit_gfx_arena_find(img, 0, r);
+  if (pages) {
+    return pages;
+  }
+
+  int w = img->width;
+  int h = img->pages << 3;
+  size_t len = _rotated_size(w, h, r);
+  pages = adafruit_gfx_arena_alloc(img, 0, r, len);
+  if (!pages) {
+    return NULL;
+  }
+
+  struct adafruit_gfx_image_decoder_t dec;
+  adafruit_gfx_image_decoder_init(&dec, img);
+  memset(pages, 0, len);
+
+  for (int gy = 0; gy < h; gy += 8) {
+    for (int gx = 0; gx < w; gx++) {
+      uint8_t data;
+
+      if (adafruit_gfx_image_decode(&dec, &data, 1) != 1) {
+        data = 0;
+      }
+      for (int j = 0; data; j++, data >>= 1) {
+        if (data & 0x01) {
+          _rotate_pages_set(pages, r, w, h, gx, gy + j);
+        }
+      }
+    }
+  }
+
+  return pages;
+}
+#endif
+
+// Draw a compressed page-format image (see adafruit-gfx-image.h) with the
+// top-left corner at (x, y).  The image is opaque: set bits are drawn WHITE
+// and clear bits BLACK.  When the image (or a copy of it turned for the
+// buffer rotation) lines up with the buffer pages it is decoded directly
+// into the draw cache without any intermediate buffer.
+int adafruit_gfx_drawImage(int x, int y, const GFXimage *img)
+{
+  LATENCY_PRIMITIVE(GFX_LATENCY_BITMAP);
+
+  if (!img || !img->data) {
+    return -EINVAL;
+  }
+
+  if (_clip_reject(x, y, img->width, img->pages << 3)) {
+    return 0;
+  }
+  if (STRIP_RECORD(STRIP_OP_IMAGE, img, NULL, x, y)) {
+    return 0;
+  }
+
+  if (display_data.start_line & 0x07) {
+    return _drawImageRotated(x, y, img);
+  }
+
+  // The image and its visible part, in buffer coordinates
+  int r = display_data.buf_rotation;
+  int bx = x, by = y, bw = img->width, bh = img->pages << 3;
+  int cx = x, cy = y, cw = bw, ch = bh;
+  _clip_rect(&cx, &cy, &cw, &ch);
+  _rect_to_buf(&bx, &by, &bw, &bh);
+  _rect_to_buf(&cx, &cy, &cw, &ch);
+
+  if (r == 0) {
+    return _drawImagePages(bx, by, img, cx, cy, cw, ch);
+  }
+  if (img->rotated[r]) {
+    return _drawImagePages(bx, by, img->rotated[r], cx, cy, cw, ch);
+  }
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+  const uint8_t *pages = _image_arena(img, r);
+  if (pages) {
+    return _blitPages(bx, by, bw, bh, pages, NULL, cx, cy, cw, ch, WHITE, BLACK);
+  }
+#endif
+
+  return _drawImageRotated(x, y, img);
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+// Uncompressed w x h page bits, and their mask if given, turned for buffer
+// rotation r into one arena block: the bits, then the mask.  The mask is the
+// block's index so the same bits under another mask are another block.
+static const uint8_t *_pages_arena(const uint8_t *bits, const uint8_t *mask, int w, int h, int r)
+{
+  uint8_t *out = adafruit_gfx_arena_find(bits, (uintptr_t)mask, r);
+  if (out) {
+    return out;
+  }
+
+  size_t len = _rotated_size(w, h, r);
+  out = adafruit_gfx_arena_alloc(bits, (uintptr_t)mask, r, mask ? len * 2 : len);
+  if (!out) {
+    return NULL;
+  }
+
+  memset(out, 0, mask ? len * 2 : len);
+  for (int gy = 0; gy < h; gy++) {
+    for (int gx = 0; gx < w; gx++) {
+      int i = (gy >> 3) * w + gx;
+      uint8_t bit = 1 << (gy & 0x07);
+
+      if (bits[i] & bit) {
+        _rotate_pages_set(out, r, w, h, gx, gy);
+      }
+      if (mask && (mask[i] & bit)) {
+        _rotate_pages_set(&out[len], r, w, h, gx, gy);
+      }
+    }
+  }
+
+  return out;
+}
+#endif
+
+// Draw uncompressed page-format bits (w bytes per page, bit 0 at the top,
+// like the display RAM) with the top-left corner at (x, y).  Where the
+// mask (same layout) is set, set bits are drawn WHITE and clear bits BLACK.
+// Without a mask set bits toggle what is below and clear bits leave it.
+// Lined up with the buffer pages this is a masked byte per column.
+int adafruit_gfx_drawPages(int x, int y, int w, int h, const uint8_t *bits, const uint8_t *mask)
+{
+  LATENCY_PRIMITIVE(GFX_LATENCY_BITMAP);
+
+  if (!bits) {
+    return -EINVAL;
+  }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  // Nothing keeps the bits around until the strips are rendered
+  return -ENOTSUP;
+#endif
+
+  int cx = x, cy = y, cw = w, ch = h;
+  if (!_clip_rect(&cx, &cy, &cw, &ch)) {
+    return 0;
+  }
+
+#ifndef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  if (!(display_data.start_line & 0x07)) {
+    int r = display_data.buf_rotation;
+    const uint8_t *src = r == 0 ? bits : NULL;
+    const uint8_t *msrc = mask;
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+    if (r != 0) {
+      src = _pages_arena(bits, mask, w, h, r);
+      msrc = (src && mask) ? &src[_rotated_size(w, h, r)] : NULL;
+    }
+#endif
+
+    if (src) {
+      int bx = x, by = y, bw = w, bh = h;
+      _rect_to_buf(&bx, &by, &bw, &bh);
+      _rect_to_buf(&cx, &cy, &cw, &ch);
+      if (mask) {
+        return _blitPages(bx, by, bw, bh, src, msrc, cx, cy, cw, ch, WHITE, BLACK);
+      }
+      return _blitPages(bx, by, bw, bh, src, NULL, cx, cy, cw, ch, INVERSE, INVERSE);
+    }
+  }
+#endif
+
+  for (int j = cy - y; j < cy - y + ch; j++) {
+    for (int i = cx - x; i < cx - x + cw; i++) {
+      int n = (j >> 3) * w + i;
+      uint8_t bit = 1 << (j & 0x07);
+
+      if (mask) {
+        if (mask[n] & bit) {
+          _drawPixelInternal(x + i, y + j, (bits[n] & bit) ? WHITE : BLACK);
+        }
+      } else if (bits[n] & bit) {
+        _drawPixelInternal(x + i, y + j, INVERSE);
+      }
+    }
+  }
+
+  return 0;
+}
+
+// Stream a full-screen compressed image straight to the panel, one page at
+// a time.  The draw buffer is left untouched, the next display() replaces it.
+int adafruit_gfx_displayImage(const GFXimage *img)
+{
+  if (!img || !img->data || img->width != SSD1306_LCDWIDTH ||
+      img->pages != (SSD1306_LCDHEIGHT >> 3)) {
+    return -EINVAL;
+  }
+
+  int ret = _set_window(0, SSD1306_LCDWIDTH - 1, 0, (SSD1306_LCDHEIGHT >> 3) - 1);
+  if (ret != 0) {
+    return ret;
+  }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_SHADOW_FRAME
+  display_data.shadow_valid = false;
+#endif
+
+  struct adafruit_gfx_image_decoder_t dec;
+  adafruit_gfx_image_decoder_init(&dec, img);
+
+  for (int page = 0; page < img->pages; page++) {
+    if (adafruit_gfx_image_decode(&dec, display_data.xfer, SSD1306_LCDWIDTH) != SSD1306_LCDWIDTH) {
+      return -EINVAL;
+    }
+    if (display_data.inverted) {
+      adafruit_gfx_rop_invert(display_data.xfer, SSD1306_LCDWIDTH);
+    }
+
+    ret = _bus_write(display_data.xfer, SSD1306_LCDWIDTH, false);
+    if (ret != 0) {
+      return ret;
+    }
+  }
+
+  return 0;
+}
+
+// Glyph by index into the font's glyph array.  Fonts kept on a device go
+// through the glyph cache, NULL if the glyph couldn't be read.
+static GFXglyph *_font_glyph_at(const GFXfont *font, uint32_t index)
 {
-  int i, j, byteWidth = (w + 7) / 8;
-  uint8_t byte = 0;
+#ifdef CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL
+  if (font->storage) {
+    return adafruit_gfx_font_cache_glyph(font, index);
+  }
+#endif
 
-  for(j=0; j<h; j++) {
-    for(i=0; i<w; i++ ) {
-      if(i & 7) {
-        byte <<= 1;
+  return &font->glyph[index];
+}
+
+// Look up the glyph for a code point, NULL if the font doesn't have it.
+// Sparse fonts are searched by binary search over their sorted ranges.
+static GFXglyph *_font_glyph(const GFXfont *font, uint32_t cp)
+{
+  if (font->ranges) {
+    int lo = 0;
+    int hi = font->range_count - 1;
+
+    while (lo <= hi) {
+      int mid = (lo + hi) >> 1;
+      const GFXrange *range = &font->ranges[mid];
+
+      if (cp < range->first) {
+        hi = mid - 1;
+      } else if (cp - range->first >= range->length) {
+        lo = mid + 1;
+      } else if (font->fixed_glyph) {
+        return font->fixed_glyph;
       } else {
-        byte = bitmap[j * byteWidth + i / 8];
-      }
-      
-      if(byte & 0x80) {
-        adafruit_gfx_drawPixel(x+i, y+j, color);
-      } else if(color != bg) {
-        adafruit_gfx_drawPixel(x+i, y+j, bg);
+        return _font_glyph_at(font, range->glyphIndex + (cp - range->first));
       }
     }
+
+    return NULL;
   }
-}
 
-//Draw XBitMap Files (*.xbm), exported from GIMP,
-//Usage: Export from GIMP to *.xbm, rename *.xbm to *.c and open in editor.
-//C Array can be directly used with this function
-void adafruit_gfx_drawXBitmap(int x, int y,
- const uint8_t *bitmap, int w, int h, int color) {
+  if ((cp < font->first) || (cp > font->last)) {
+    return NULL;
+  }
 
-  int i, j, byteWidth = (w + 7) / 8;
-  uint8_t byte = 0;
+  if (font->fixed_glyph) {
+    return font->fixed_glyph;
+  }
 
-  for(j=0; j<h; j++) {
-    for(i=0; i<w; i++ ) {
-      if(i & 7) {
-        byte >>= 1;
-      } else {
-        byte = bitmap[j * byteWidth + i / 8];
-      }
-      
-      if(byte & 0x01) {
-        adafruit_gfx_drawPixel(x+i, y+j, color);
-      }
+  return _font_glyph_at(font, cp - font->first);
+}
+
+// Decode the next code point from a UTF-8 string, advancing *str.  Returns 0
+// at the end of the string and U+FFFD for malformed sequences.
+static uint32_t _utf8_next(const char **str)
+{
+  const uint8_t *s = (const uint8_t *)*str;
+  uint32_t cp = *s++;
+  int extra;
+
+  if (cp < 0x80) {
+    extra = 0;
+  } else if ((cp & 0xE0) == 0xC0) {
+    cp &= 0x1F;
+    extra = 1;
+  } else if ((cp & 0xF0) == 0xE0) {
+    cp &= 0x0F;
+    extra = 2;
+  } else if ((cp & 0xF8) == 0xF0) {
+    cp &= 0x07;
+    extra = 3;
+  } else {
+    *str = (const char *)s;
+    return 0xFFFD;
+  }
+
+  while (extra--) {
+    if ((*s & 0xC0) != 0x80) {
+      // Truncated sequence, resume at the offending byte
+      *str = (const char *)s;
+      return 0xFFFD;
     }
+    cp = (cp << 6) | (*s++ & 0x3F);
   }
+
+  *str = (const char *)s;
+  return cp;
 }
 
-size_t adafruit_gfx_write(uint8_t c) {
-  GFXfont *font = display_data.gfxFont;
+// Next character of a string, as a code point if UTF-8 is enabled or as a
+// raw byte otherwise
+static uint32_t _string_next(const char **str)
+{
+  if (display_data.utf8) {
+    return _utf8_next(str);
+  }
+
+  return (uint8_t)*(*str)++;
+}
+
+size_t adafruit_gfx_writeCodepoint(uint32_t cp) {
+  const GFXfont *font = display_data.gfxFont;
   
   if(!font) { // 'Classic' built-in font
-    font = (GFXfont *)&adafruit_gfx_font_default;
+    font = &adafruit_gfx_font_default;
   }
   
-  if(c == '\n') {
+  if(cp == '\n') {
     display_data.cursor_x  = 0;
-    display_data.cursor_y += display_data.textsize * display_data.gfxFont->yAdvance;
-  } else if (c == '\r') {
+    display_data.cursor_y += display_data.textsize * font->yAdvance;
+  } else if (cp == '\r') {
     return 0;
   } else {
-    uint8_t first = display_data.gfxFont->first;
-    if((c < first) || (c > display_data.gfxFont->last)) {
-      return 0;
-    }
-    
-    uint8_t c2 = c - display_data.gfxFont->first;
-    GFXglyph *glyph = display_data.gfxFont->fixed_glyph;
+    GFXglyph *glyph = _font_glyph(font, cp);
     if (!glyph) {
-      glyph = &(display_data.gfxFont->glyph[c2]);
+      return 0;
     }
     
     int w = glyph->width;
@@ -917,10 +3563,16 @@ size_t adafruit_gfx_write(uint8_t c) {
       if(display_data.wrap && ((display_data.cursor_x + display_data.textsize * (xo + w)) >= display_data.width)) {
         // Drawing character would go off right edge; wrap to new line
         display_data.cursor_x = 0;
-        display_data.cursor_y += display_data.textsize * display_data.gfxFont->yAdvance;
+        display_data.cursor_y += display_data.textsize * font->yAdvance;
+      }
+
+      if (!display_data.gfxFont) {
+        adafruit_gfx_drawChar(display_data.cursor_x, display_data.cursor_y, cp, 
+            display_data.textcolor, display_data.textbgcolor, display_data.textsize);
+      } else {
+        _drawFontGlyph(display_data.cursor_x, display_data.cursor_y, font, glyph,
+            display_data.textcolor, display_data.textsize);
       }
-      adafruit_gfx_drawChar(display_data.cursor_x, display_data.cursor_y, c, 
-          display_data.textcolor, display_data.textbgcolor, display_data.textsize);
     }
     display_data.cursor_x += glyph->xAdvance * display_data.textsize;
   }
@@ -928,55 +3580,390 @@ size_t adafruit_gfx_write(uint8_t c) {
   return 1;
 }
 
+size_t adafruit_gfx_write(uint8_t c) {
+  if (!display_data.utf8) {
+    return adafruit_gfx_writeCodepoint(c);
+  }
+
+  // Byte-at-a-time UTF-8 decoder, so print-style callers can feed us a
+  // string one byte at a time
+  if ((c & 0xC0) == 0x80) {
+    if (!display_data.utf8_remaining) {
+      return 0;   // Stray continuation byte
+    }
+
+    display_data.utf8_cp = (display_data.utf8_cp << 6) | (c & 0x3F);
+    if (--display_data.utf8_remaining) {
+      return 1;
+    }
+
+    return adafruit_gfx_writeCodepoint(display_data.utf8_cp);
+  }
+
+  display_data.utf8_remaining = 0;
+  if (c < 0x80) {
+    return adafruit_gfx_writeCodepoint(c);
+  } else if ((c & 0xE0) == 0xC0) {
+    display_data.utf8_cp = c & 0x1F;
+    display_data.utf8_remaining = 1;
+  } else if ((c & 0xF0) == 0xE0) {
+    display_data.utf8_cp = c & 0x0F;
+    display_data.utf8_remaining = 2;
+  } else if ((c & 0xF8) == 0xF0) {
+    display_data.utf8_cp = c & 0x07;
+    display_data.utf8_remaining = 3;
+  } else {
+    return 0;
+  }
+
+  return 1;
+}
+
+// Resolve the next glyph of a string that draws anything, moving the pen
+// past it and past the newlines and blank glyphs before it.  Carriage
+// returns are skipped, as write() does.  False at the end of the string.
+static bool _string_glyph(const char **str, const GFXfont *font, int ts,
+      int *pen_x, int *pen_y, struct adafruit_gfx_layout_t *out)
+{
+  uint32_t cp;
+
+  while ((cp = _string_next(str))) {
+    if (cp == '\n') {
+      *pen_x = 0;
+      *pen_y += ts * font->yAdvance;
+      continue;
+    }
+    if (cp == '\r') {
+      continue;
+    }
+
+    GFXglyph *glyph = _font_glyph(font, cp);
+    if (!glyph) {
+      continue;
+    }
+
+    out->glyph = glyph;
+    out->cp = cp;
+    out->x = *pen_x;
+    out->y = *pen_y;
+    *pen_x += glyph->xAdvance * ts;
+
+    if (glyph->width && glyph->height) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Measure and draw a string.  The glyphs are resolved into a small layout
+// array while measuring, which gives the bounding box for alignment (and
+// the optional background fill) and is then replayed to draw.  Glyphs past
+// the first CONFIG_ADAFRUIT_SSD1306_STRING_LAYOUT_SIZE are only measured,
+// and resolved again from where the array filled up as they are drawn.
+// Newlines start a new line, there is no automatic wrapping.  The text
+// cursor is not moved.  Returns the number of glyphs drawn.
+int adafruit_gfx_drawString(int x, int y, const char *str, int flags,
+      int *x1, int *y1, int *w, int *h) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_TEXT);
+
+  const GFXfont *font = display_data.gfxFont;
+  struct adafruit_gfx_layout_t *layout = display_data.layout;
+  struct adafruit_gfx_layout_t g;
+  int ts = display_data.textsize;
+  int color = display_data.textcolor;
+  int bg = display_data.textbgcolor;
+  int n = 0;
+  int pen_x = 0;
+  int pen_y = 0;
+  int minx = INT16_MAX;
+  int miny = INT16_MAX;
+  int maxx = INT16_MIN;
+  int maxy = INT16_MIN;
+  // Where the glyphs that didn't fit the layout start
+  const char *rest = NULL;
+  int rest_x = 0;
+  int rest_y = 0;
+  
+  if(!font) { // 'Classic' built-in font
+    font = &adafruit_gfx_font_default;
+  }
+
+  while (_string_glyph(&str, font, ts, &pen_x, &pen_y, &g)) {
+    const GFXglyph *glyph = g.glyph;
+    int gx;
+    int gy;
+    int gw;
+    int gh;
+
+    if (!display_data.gfxFont) {
+      // Classic glyphs are drawn as a full cell, including the spacing
+      gx = g.x;
+      gy = g.y;
+      gw = glyph->xAdvance * ts;
+      gh = font->yAdvance * ts;
+    } else {
+      gx = g.x + glyph->xOffset * ts;
+      gy = g.y + glyph->yOffset * ts;
+      gw = glyph->width * ts;
+      gh = glyph->height * ts;
+    }
+
+    minx = min(minx, gx);
+    miny = min(miny, gy);
+    maxx = max(maxx, gx + gw - 1);
+    maxy = max(maxy, gy + gh - 1);
+
+    if (n < CONFIG_ADAFRUIT_SSD1306_STRING_LAYOUT_SIZE) {
+      layout[n] = g;
+      if (n == CONFIG_ADAFRUIT_SSD1306_STRING_LAYOUT_SIZE - 1) {
+        rest = str;
+        rest_x = pen_x;
+        rest_y = pen_y;
+      }
+    }
+    n++;
+  }
+
+  if (n == 0) {
+    minx = maxx = miny = maxy = 0;
+    maxx--;
+    maxy--;
+  }
+
+  int bw = maxx - minx + 1;
+  int bh = maxy - miny + 1;
+
+  switch (flags & GFX_ALIGN_HMASK) {
+    case GFX_ALIGN_CENTER:
+      x -= minx + bw / 2;
+      break;
+    case GFX_ALIGN_RIGHT:
+      x -= maxx + 1;
+      break;
+  }
+
+  switch (flags & GFX_ALIGN_VMASK) {
+    case GFX_ALIGN_TOP:
+      y -= miny;
+      break;
+    case GFX_ALIGN_MIDDLE:
+      y -= miny + bh / 2;
+      break;
+    case GFX_ALIGN_BOTTOM:
+      y -= maxy + 1;
+      break;
+  }
+
+  if (!(flags & GFX_STRING_MEASURE)) {
+    if ((flags & GFX_STRING_FILL_BOX) && n && bg != color) {
+      adafruit_gfx_fillRect(x + minx, y + miny, bw, bh, bg);
+      // The box already holds the background, draw the glyphs transparently
+      bg = color;
+    }
+
+    for (int i = 0; i < n; i++) {
+      const struct adafruit_gfx_layout_t *l = &layout[i];
+
+      if (i >= CONFIG_ADAFRUIT_SSD1306_STRING_LAYOUT_SIZE) {
+        _string_glyph(&rest, font, ts, &rest_x, &rest_y, &g);
+        l = &g;
+      }
+
+      if (!display_data.gfxFont) {
+        adafruit_gfx_drawChar(x + l->x, y + l->y, l->cp, color, bg, ts);
+      } else {
+        const GFXglyph *glyph = l->glyph;
+#ifdef CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL
+        // Later glyphs of the string may have evicted this one from the cache
+        if (font->storage && !(glyph = _font_glyph(font, l->cp))) {
+          continue;
+        }
+#endif
+        _drawFontGlyph(x + l->x, y + l->y, font, glyph, color, ts);
+      }
+    }
+  }
+
+  if (x1) {
+    *x1 = x + minx;
+  }
+  if (y1) {
+    *y1 = y + miny;
+  }
+  if (w) {
+    *w = bw;
+  }
+  if (h) {
+    *h = bh;
+  }
+
+  return n;
+}
+
+// Write a whole string at the cursor, UTF-8 decoded if enabled
+size_t adafruit_gfx_print(const char *str) {
+  size_t count = 0;
+  uint32_t cp;
+
+  display_data.utf8_remaining = 0;
+  while ((cp = _string_next(&str))) {
+    count += adafruit_gfx_writeCodepoint(cp);
+  }
+
+  return count;
+}
+
 // Draw a character
 void adafruit_gfx_drawChar(int x, int y, unsigned char c, int color, int bg, int size) {
+  LATENCY_PRIMITIVE(GFX_LATENCY_TEXT);
+
   GFXfont *font = display_data.gfxFont;
+
+  if (size < 1) {
+    return;
+  }
   
   if(!font) { // 'Classic' built-in font
-    font = (GFXfont *)&adafruit_gfx_font_default;
-
-    if((x >= display_data.width)   || // Clip right
-       (y >= display_data.height)  || // Clip bottom
-       ((x + 6 * size - 1) < 0)   || // Clip left
-       ((y + 8 * size - 1) < 0))     // Clip top
-      return;
-
     if(!display_data.cp437 && (c >= 176)) {
       c++; // Handle 'classic' charset behavior
     }
 
-    for (int i = 0; i < 6; i++) {
-      int line = 0x00;
-      
-      if (i < 5) {
-        line = font->bitmap[(c*5)+i];
-      }
+    _drawClassicChar(x, y, c, color, bg, size);
+  } else { // Custom font
+    GFXglyph *glyph = _font_glyph(font, c);
+    if (glyph) {
+      _drawFontGlyph(x, y, font, glyph, color, size);
+    }
+  } // End classic vs custom font
+}
 
-      for(int j = 0; j < 8; j++, line >>= 1) {
-        if(line & 0x1) {
-          if(size == 1) {
-            adafruit_gfx_drawPixel(x+i, y+j, color);
-          } else {
-            adafruit_gfx_fillRect(x+(i*size), y+(j*size), size, size, color);
-          }
-        } else if(bg != color) {
-          if(size == 1) {
-            adafruit_gfx_drawPixel(x+i, y+j, bg);
-          } else {
-            adafruit_gfx_fillRect(x+i*size, y+j*size, size, size, bg);
-          }
+// Draw glyph c of the classic font, a 6x8 cell including the spacing
+static void _drawClassicChar(int x, int y, unsigned char c, int color, int bg, int size)
+{
+  const GFXfont *font = &adafruit_gfx_font_default;
+
+  // Resolve the clip once, then only visit the visible cells
+  int cx = x, cy = y, cw = 6 * size, ch = 8 * size;
+  if (!_clip_rect(&cx, &cy, &cw, &ch)) {
+    return;
+  }
+  if (STRIP_RECORD(STRIP_OP_CHAR, NULL, NULL, x, y, c, color, bg, size)) {
+    return;
+  }
+
+  int i0 = (cx - x) / size;
+  int i1 = (cx + cw - x + size - 1) / size;
+  int j0 = (cy - y) / size;
+  int j1 = (cy + ch - y + size - 1) / size;
+
+  for (int i = i0; i < i1; i++) {
+    int line = 0x00;
+    
+    if (i < 5) {
+      line = font->bitmap[(c*5)+i] >> j0;
+    }
+
+    for(int j = j0; j < j1; j++, line >>= 1) {
+      if(line & 0x1) {
+        if(size == 1) {
+          _drawPixelInternal(x+i, y+j, color);
+        } else {
+          adafruit_gfx_fillRect(x+(i*size), y+(j*size), size, size, color);
+        }
+      } else if(bg != color) {
+        if(size == 1) {
+          _drawPixelInternal(x+i, y+j, bg);
+        } else {
+          adafruit_gfx_fillRect(x+i*size, y+j*size, size, size, bg);
         }
       }
     }
-  } else { // Custom font
+  }
+}
+
+#ifndef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+// The glyph's bits turned for buffer rotation r: the font's own variant if
+// it has one, otherwise rendered into the arena on first use.  NULL if
+// neither is available.
+static const uint8_t *_glyph_pages(const GFXfont *font, const GFXglyph *glyph, int r)
+{
+  const GFXpageFont *pages = font->pages;
+  int index = glyph - font->glyph;
+
+  if (pages && pages->bitmap[r]) {
+    return &pages->bitmap[r][pages->offset[r][index]];
+  }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+  uint8_t *out = adafruit_gfx_arena_find(font, index, r);
+  if (out) {
+    return out;
+  }
+
+  int w = glyph->width;
+  int h = glyph->height;
+  size_t len = _rotated_size(w, h, r);
+  out = adafruit_gfx_arena_alloc(font, index, r, len);
+  if (!out) {
+    return NULL;
+  }
+
+  memset(out, 0, len);
+  for (int gy = 0, bit = 0; gy < h; gy++) {
+    for (int gx = 0; gx < w; gx++, bit++) {
+      if (font->bitmap[glyph->bitmapOffset + (bit >> 3)] & (0x80 >> (bit & 0x07))) {
+        _rotate_pages_set(out, r, w, h, gx, gy);
+      }
+    }
+  }
+
+  return out;
+#else
+  return NULL;
+#endif
+}
+
+// Blit a glyph from its page-format bits for the buffer rotation, one masked
+// byte per buffer column and page instead of one pixel per bit.  (ox, oy) is
+// the glyph's logical top-left corner and (cx, cy, cw, ch) the part of it
+// inside the clip.  False if there are no page-format bits to use.
+static bool _drawPageGlyph(const GFXfont *font, const GFXglyph *glyph, int ox, int oy,
+      int cx, int cy, int cw, int ch, int color)
+{
+  if (font->fixed_glyph || (display_data.start_line & 0x07)) {
+    return false;
+  }
+#ifdef CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL
+  if (font->storage) {
+    return false;
+  }
+#endif
+
+  const uint8_t *bitmap = _glyph_pages(font, glyph, display_data.buf_rotation);
+  if (!bitmap) {
+    return false;
+  }
+
+  int rx = ox, ry = oy, rw = glyph->width, rh = glyph->height;
+  _rect_to_buf(&rx, &ry, &rw, &rh);
+  _rect_to_buf(&cx, &cy, &cw, &ch);
+  _blitPages(rx, ry, rw, rh, bitmap, NULL, cx, cy, cw, ch, color, color);
+
+  return true;
+}
+#endif
 
-    // Character is assumed previously filtered by write() to eliminate
-    // newlines, returns, non-printable characters, etc.  Calling drawChar()
-    // directly with 'bad' characters of font may cause mayhem!
+static void _drawFontGlyph(int x, int y, const GFXfont *font, const GFXglyph *glyph,
+      int color, int size)
+{
+    const uint8_t *bitmap = font->bitmap;
 
-    c -= display_data.gfxFont->first;
-    GFXglyph *glyph  = &(display_data.gfxFont->glyph[c]);
-    uint8_t  *bitmap = display_data.gfxFont->bitmap;
+#ifdef CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL
+    if (font->storage) {
+      bitmap = adafruit_gfx_font_cache_bitmap(glyph);
+    }
+#endif
 
     int bo = glyph->bitmapOffset;
     int w = glyph->width;
@@ -985,19 +3972,28 @@ void adafruit_gfx_drawChar(int x, int y, unsigned char c, int color, int bg, int
     int xo = glyph->xOffset;
     int yo = glyph->yOffset;
     
-    int xx;
-    int yy;
-    int bits = 0;
-    int bit = 0;
-    int xo16 = 0;
-    int yo16 = 0;
-
-    if(size > 1) {
-      xo16 = xo;
-      yo16 = yo;
+    // Glyph cells are size x size pixels from this origin
+    int ox = x + xo * size;
+    int oy = y + yo * size;
+
+    // Resolve the clip once for the whole glyph, then only walk the bits of
+    // the visible cells
+    int cx = ox, cy = oy, cw = w * size, ch = h * size;
+    if (!_clip_rect(&cx, &cy, &cw, &ch)) {
+      return;
     }
-
-    // Todo: Add character clipping here
+    if (STRIP_RECORD(STRIP_OP_GLYPH, font, glyph, x, y, color, size)) {
+      return;
+    }
+#ifndef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+    if (size == 1 && _drawPageGlyph(font, glyph, ox, oy, cx, cy, cw, ch, color)) {
+      return;
+    }
+#endif
+    int xx0 = (cx - ox) / size;
+    int xx1 = (cx + cw - ox + size - 1) / size;
+    int yy0 = (cy - oy) / size;
+    int yy1 = (cy + ch - oy + size - 1) / size;
 
     // NOTE: THERE IS NO 'BACKGROUND' COLOR OPTION ON CUSTOM FONTS.
     // THIS IS ON PURPOSE AND BY DESIGN.  The background color feature
@@ -1015,23 +4011,18 @@ void adafruit_gfx_drawChar(int x, int y, unsigned char c, int color, int bg, int
     // displays supporting setAddrWindow() and pushColors()), but haven't
     // implemented this yet.
 
-    for(yy=0; yy<h; yy++) {
-      for(xx=0; xx<w; xx++) {
-        if(!(bit++ & 0x07)) {
-          bits = bitmap[bo++];
-        }
-        
-        if(bits & 0x80) {
+    for(int yy=yy0; yy<yy1; yy++) {
+      int bit = yy * w + xx0;
+      for(int xx=xx0; xx<xx1; xx++, bit++) {
+        if(bitmap[bo + (bit >> 3)] & (0x80 >> (bit & 0x07))) {
           if(size == 1) {
-            adafruit_gfx_drawPixel(x+xo+xx, y+yo+yy, color);
+            _drawPixelInternal(ox+xx, oy+yy, color);
           } else {
-            adafruit_gfx_fillRect(x+(xo16+xx)*size, y+(yo16+yy)*size, size, size, color);
+            adafruit_gfx_fillRect(ox+xx*size, oy+yy*size, size, size, color);
           }
         }
-        bits <<= 1;
       }
     }
-  } // End classic vs custom font
 }
 
 void adafruit_gfx_setCursor(int x, int y) {
@@ -1047,8 +4038,21 @@ int adafruit_gfx_getCursorY(void) {
   return display_data.cursor_y;
 }
 
+const GFXfont *adafruit_gfx_getFont(void) {
+  return display_data.gfxFont;
+}
+
+int adafruit_gfx_getTextSize(void) {
+  return display_data.textsize;
+}
+
+void adafruit_gfx_getTextColor(int *c, int *b) {
+  *c = display_data.textcolor;
+  *b = display_data.textbgcolor;
+}
+
 void adafruit_gfx_setTextSize(int ts) {
-  display_data.textsize = min(ts, 1);
+  display_data.textsize = max(ts, 1);
 }
 
 void adafruit_gfx_setTextColor(int c, int b) {
@@ -1066,7 +4070,44 @@ int adafruit_gfx_getRotation(void) {
   return display_data.rotation;
 }
 
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+// Lay the draw buffers out for the current rotation.  At 90 and 270 degrees
+// they are folded into logical width x height, so drawing runs along page
+// rows just like at rotation 0 and the flush does the rotating.  Neither
+// layout can be read as the other, so the buffers and layers are cleared.
+static void _buf_layout(void)
+{
+  bool folded = _buf_folded();
+
+  display_data.buf_width = folded ? display_data.width : display_data.raw_width;
+  display_data.buf_height = folded ? display_data.height : display_data.raw_height;
+  display_data.cache.stride = display_data.buf_width;
+
+  // The folded buffer has no row ring
+  if (display_data.start_line) {
+    display_data.start_line = 0;
+    display_data.buffer[0] = SSD1306_SETSTARTLINE;
+    _bus_write(display_data.buffer, 1, true);
+  }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_LAYERS
+  for (int i = 0; i < CONFIG_ADAFRUIT_SSD1306_LAYER_COUNT; i++) {
+    if (adafruit_gfx_cache_source_choose(&display_data.cache, &display_data.layers[i].source) == 0) {
+      adafruit_gfx_cache_fill_all(&display_data.cache, 0x00);
+    }
+  }
+#endif
+  if (adafruit_gfx_cache_source_choose(&display_data.cache, &display_data.draw_cache) == 0) {
+    adafruit_gfx_cache_fill_all(&display_data.cache, display_data.inverted ? 0xFF : 0x00);
+  }
+}
+#endif
+
 void adafruit_gfx_setRotation(int x) {
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+  bool relayout = (_buf_folded() || (x & 1)) && display_data.rotation != (x & 0x03);
+#endif
+
   display_data.rotation = (x & 0x03);
   switch(display_data.rotation) {
    case 0:
@@ -1080,6 +4121,61 @@ void adafruit_gfx_setRotation(int x) {
     display_data.height = display_data.raw_width;
     break;
   }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+  if (relayout) {
+    _buf_layout();
+  }
+#endif
+  display_data.buf_rotation = _buf_folded() ? 0 : display_data.rotation;
+
+  // The clip is in logical coordinates, it doesn't survive a rotation
+  adafruit_gfx_resetClip();
+}
+
+// Restrict all drawing to a logical rectangle.  The clip is resolved once
+// per primitive, anything entirely outside it is rejected up front.
+void adafruit_gfx_setClipRect(int x, int y, int w, int h) {
+  if (!_clip_logical(&x, &y, &w, &h)) {
+    // Nothing visible, every primitive gets rejected
+    x = y = w = h = 0;
+  }
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  // While a strip is rendered nothing outside its page row may be touched
+  if (display_data.strip_page >= 0) {
+    int sx = 0, sy = display_data.strip_page << 3, sw = display_data.raw_width, sh = 8;
+    _rect_rotate((4 - display_data.rotation) & 0x03, display_data.width, display_data.height,
+                 &sx, &sy, &sw, &sh);
+
+    int x1 = min(x + w, sx + sw);
+    int y1 = min(y + h, sy + sh);
+    x = max(x, sx);
+    y = max(y, sy);
+    w = max(x1 - x, 0);
+    h = max(y1 - y, 0);
+  }
+#endif
+
+  display_data.clip_x0 = x;
+  display_data.clip_y0 = y;
+  display_data.clip_x1 = x + w;
+  display_data.clip_y1 = y + h;
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+  _strip_state();
+#endif
+}
+
+void adafruit_gfx_getClipRect(int *x, int *y, int *w, int *h) {
+  *x = display_data.clip_x0;
+  *y = display_data.clip_y0;
+  *w = display_data.clip_x1 - display_data.clip_x0;
+  *h = display_data.clip_y1 - display_data.clip_y0;
+}
+
+void adafruit_gfx_resetClip(void) {
+  adafruit_gfx_setClipRect(0, 0, display_data.width, display_data.height);
 }
 
 // Enable (or disable) Code Page 437-compatible charset.
@@ -1093,6 +4189,13 @@ void adafruit_gfx_cp437(bool x) {
   display_data.cp437 = x;
 }
 
+// Enable (or disable) UTF-8 decoding in write(), print() and getTextBounds().
+// Needed to reach code points above 0xFF in sparse fonts, see GFXrange.
+void adafruit_gfx_utf8(bool x) {
+  display_data.utf8 = x;
+  display_data.utf8_remaining = 0;
+}
+
 void adafruit_gfx_setFont(const GFXfont *f) {
   if(f) {          // Font struct pointer passed in?
     if(!display_data.gfxFont) { // And no current font struct?
@@ -1111,17 +4214,17 @@ void adafruit_gfx_setFont(const GFXfont *f) {
 // Pass string and a cursor position, returns UL corner and W, H.
 void adafruit_gfx_getTextBounds(char *str, int x, int y, int ts,
                                 int *x1, int *y1, int *w, int *h) {
-  GFXfont *font = display_data.gfxFont;
+  const GFXfont *font = display_data.gfxFont;
   
   if(!font) { // 'Classic' built-in font
-    font = (GFXfont *)&adafruit_gfx_font_default;
+    font = &adafruit_gfx_font_default;
   }
 
-  ts = min(ts, 1);
+  ts = max(ts, 1);
 
-  GFXglyph *fixed_glyph = font->fixed_glyph;
   GFXglyph *glyph;
-  uint8_t c; // Current character
+  uint32_t c; // Current character
+  const char *s = str;
   
   int minx = display_data.width;
   int miny = display_data.height;
@@ -1133,25 +4236,19 @@ void adafruit_gfx_getTextBounds(char *str, int x, int y, int ts,
   int x_lr;
   int y_lr;
 
-  while((c = *str++)) {
+  while((c = _string_next(&s))) {
     if (c == '\n') { // newline
       x  = 0;  // Reset x
-      y += ts * display_data.gfxFont->yAdvance; // Advance y by 1 line
+      y += ts * font->yAdvance; // Advance y by 1 line
     } else if (c == '\r') {
       continue;
-    } else if((c < font->first) || (c > font->last)) { // Char not present in current font
+    } else if(!(glyph = _font_glyph(font, c))) { // Char not present in current font
       continue;
     } else {
-      c -= font->first;
-      glyph = fixed_glyph;
-      if (!glyph) {
-        glyph = &(display_data.gfxFont->glyph[c]);
-      }
-
       if(display_data.wrap && ((x + ((glyph->xOffset + glyph->width) * ts)) >= display_data.width)) {
         // Line wrap
         x = 0;  // Reset x to 0
-        y += ts * display_data.gfxFont->yAdvance; // Advance y by 1 line
+        y += ts * font->yAdvance; // Advance y by 1 line
       }
 
       x_ul = x + glyph->xOffset * ts;
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-arena.h"
+
+struct adafruit_gfx_arena_tag_t {
+    const void *owner;      /* NULL while unused */
+    uint32_t index;
+    uint8_t rotation;
+    uint8_t *data;
+};
+
+static uint8_t arena[CONFIG_ADAFRUIT_SSD1306_ARENA_SIZE] __aligned(4);
+static size_t arena_used;
+static struct adafruit_gfx_arena_tag_t tags[CONFIG_ADAFRUIT_SSD1306_ARENA_TAGS];
+static struct adafruit_gfx_arena_stats_t stats;
+
+static struct adafruit_gfx_arena_tag_t *_tag(const void *owner, uint32_t index, int rotation)
+{
+    uint32_t key = ((uintptr_t)owner >> 2) + index * 4 + rotation;
+
+    return &tags[((key * 2654435761U) >> 16) % ARRAY_SIZE(tags)];
+}
+
+uint8_t *adafruit_gfx_arena_find(const void *owner, uint32_t index, int rotation)
+{
+    struct adafruit_gfx_arena_tag_t *tag = _tag(owner, index, rotation);
+
+    if (tag->owner == owner && tag->index == index && tag->rotation == rotation) {
+        stats.hits++;
+        return tag->data;
+    }
+
+    return NULL;
+}
+
+/* NULL if len is larger than the whole arena */
+uint8_t *adafruit_gfx_arena_alloc(const void *owner, uint32_t index, int rotation, size_t len)
+{
+    struct adafruit_gfx_arena_tag_t *tag = _tag(owner, index, rotation);
+
+    if (len > sizeof(arena)) {
+        stats.too_big++;
+        return NULL;
+    }
+
+    if (arena_used + len > sizeof(arena)) {
+        adafruit_gfx_arena_flush();
+        stats.resets++;
+    }
+
+    stats.renders++;
+    tag->owner = owner;
+    tag->index = index;
+    tag->rotation = rotation;
+    tag->data = &arena[arena_used];
+    arena_used += ROUND_UP(len, 4);
+
+    return tag->data;
+}
+
+/* Forget every block */
+void adafruit_gfx_arena_flush(void)
+{
+    memset(tags, 0, sizeof(tags));
+    arena_used = 0;
+}
+
+void adafruit_gfx_arena_stats(struct adafruit_gfx_arena_stats_t *out, bool reset)
+{
+    adafruit_gfx_lock();
+    if (out) {
+        *out = stats;
+        out->used = arena_used;
+    }
+
+    if (reset) {
+        memset(&stats, 0, sizeof(stats));
+    }
+    adafruit_gfx_unlock();
+}
@@ -11,11 +11,172 @@ LOG_MODULE_REGISTER(adafruit_ssd1306, CONFIG_DISPLAY_LOG_LEVEL);
 #include <zephyr.h>
 #include <device.h>
 #include <devicetree.h>
-#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
+#if defined(CONFIG_ADAFRUIT_SSD1306_CACHE) && !defined(CONFIG_ADAFRUIT_SSD1306_CACHE_HOST)
 #include <drivers/ram.h>
 #endif
 #include "adafruit-gfx-defines.h"
 #include "adafruit-gfx-cache.h"
+#include "adafruit-gfx-latency.h"
+#include "adafruit-gfx-rop.h"
+#include "adafruit-gfx-utils.h"
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_HOST
+/*
+ * native_posix stand-in for the RAM device: a host buffer, copied to and
+ * from like the device would be, or used in place when mapped.
+ */
+static uint8_t cache_host_ram[CONFIG_ADAFRUIT_SSD1306_CACHE_HOST_SIZE] __aligned(4);
+
+/* Never opened, it only marks the sources as RAM backed */
+static const struct device cache_host_dev;
+
+static __unused int ram_read(const struct device *dev, size_t offset, uint8_t *buf, size_t len)
+{
+    if (offset + len > sizeof(cache_host_ram)) {
+        return -EINVAL;
+    }
+    memcpy(buf, &cache_host_ram[offset], len);
+    return 0;
+}
+
+static __unused int ram_write(const struct device *dev, size_t offset, const uint8_t *buf,
+        size_t len)
+{
+    if (offset + len > sizeof(cache_host_ram)) {
+        return -EINVAL;
+    }
+    memcpy(&cache_host_ram[offset], buf, len);
+    return 0;
+}
+
+static int ram_get_size(const struct device *dev, size_t *size)
+{
+    *size = sizeof(cache_host_ram);
+    return 0;
+}
+#endif
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_WRITE_BEHIND
+/*
+ * Write-behind queue.  Dirty lines evicted from the cache are copied into a
+ * small ring of write buffers, and a low priority thread writes them to the
+ * RAM device while the drawing thread goes on to read the next line.  A
+ * buffer stays in the ring until its write has finished, and everything read
+ * from the device is patched from the ring oldest first, so reads always see
+ * the latest data.
+ */
+#define SSD1306_WB_BUFFERS      (CONFIG_ADAFRUIT_SSD1306_CACHE_WRITE_BUFFERS)
+
+struct adafruit_gfx_cache_wb_t {
+    const struct device *dev;
+    size_t offset;      /* device offset of the line */
+    uint8_t data[SSD1306_CACHE_LINE_SIZE] __aligned(4);
+};
+
+static struct adafruit_gfx_cache_wb_t wb_ring[SSD1306_WB_BUFFERS];
+static size_t wb_head;  /* oldest buffer, the one being written */
+static size_t wb_count;
+static int wb_error;    /* first background write that failed */
+
+K_MUTEX_DEFINE(wb_lock);
+K_SEM_DEFINE(wb_free, SSD1306_WB_BUFFERS, SSD1306_WB_BUFFERS);
+K_SEM_DEFINE(wb_pending, 0, SSD1306_WB_BUFFERS);
+
+/* Returns (and clears) the error of an earlier background write, if any */
+static int _wb_queue(const struct device *dev, size_t offset, const uint8_t *line)
+{
+    k_sem_take(&wb_free, K_FOREVER);
+
+    k_mutex_lock(&wb_lock, K_FOREVER);
+    struct adafruit_gfx_cache_wb_t *wb = &wb_ring[(wb_head + wb_count) % SSD1306_WB_BUFFERS];
+    wb->dev = dev;
+    wb->offset = offset;
+    memcpy(wb->data, line, SSD1306_CACHE_LINE_SIZE);
+    wb_count++;
+
+    int ret = wb_error;
+    wb_error = 0;
+    k_mutex_unlock(&wb_lock);
+
+    k_sem_give(&wb_pending);
+    return ret;
+}
+
+/* Wait until every queued line has reached the device */
+static int _wb_sync(void)
+{
+    for (int i = 0; i < SSD1306_WB_BUFFERS; i++) {
+        k_sem_take(&wb_free, K_FOREVER);
+    }
+    for (int i = 0; i < SSD1306_WB_BUFFERS; i++) {
+        k_sem_give(&wb_free);
+    }
+
+    k_mutex_lock(&wb_lock, K_FOREVER);
+    int ret = wb_error;
+    wb_error = 0;
+    k_mutex_unlock(&wb_lock);
+
+    return ret;
+}
+
+static void _wb_thread(void *p1, void *p2, void *p3)
+{
+    while (true) {
+        k_sem_take(&wb_pending, K_FOREVER);
+
+        k_mutex_lock(&wb_lock, K_FOREVER);
+        struct adafruit_gfx_cache_wb_t *wb = &wb_ring[wb_head];
+        k_mutex_unlock(&wb_lock);
+
+        /* Written outside the lock, the buffer isn't reused until retired */
+        int ret = ram_write(wb->dev, wb->offset, wb->data, SSD1306_CACHE_LINE_SIZE);
+
+        k_mutex_lock(&wb_lock, K_FOREVER);
+        if (ret != 0 && wb_error == 0) {
+            wb_error = ret;
+        }
+        wb_head = (wb_head + 1) % SSD1306_WB_BUFFERS;
+        wb_count--;
+        k_mutex_unlock(&wb_lock);
+
+        k_sem_give(&wb_free);
+    }
+}
+
+K_THREAD_DEFINE(adafruit_gfx_cache_wb, CONFIG_ADAFRUIT_SSD1306_CACHE_WRITE_BEHIND_STACK_SIZE,
+                _wb_thread, NULL, NULL, NULL,
+                CONFIG_ADAFRUIT_SSD1306_CACHE_WRITE_BEHIND_PRIORITY, 0, 0);
+#endif
+
+#ifdef SSD1306_CACHE_LINES
+/*
+ * Read from the RAM device.  With write-behind, the lock is held across the
+ * read so a line can't retire between being read stale and being patched.
+ */
+static int _ram_read(const struct device *dev, size_t offset, uint8_t *buf, size_t len)
+{
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_WRITE_BEHIND
+    k_mutex_lock(&wb_lock, K_FOREVER);
+    int ret = ram_read(dev, offset, buf, len);
+
+    for (size_t i = 0; ret == 0 && i < wb_count; i++) {
+        struct adafruit_gfx_cache_wb_t *wb = &wb_ring[(wb_head + i) % SSD1306_WB_BUFFERS];
+        size_t start = max(offset, wb->offset);
+        size_t end = min(offset + len, wb->offset + SSD1306_CACHE_LINE_SIZE);
+
+        if (wb->dev == dev && start < end) {
+            memcpy(&buf[start - offset], &wb->data[start - wb->offset], end - start);
+        }
+    }
+    k_mutex_unlock(&wb_lock);
+
+    return ret;
+#else
+    return ram_read(dev, offset, buf, len);
+#endif
+}
+#endif
 
 
 int adafruit_gfx_cache_init(struct adafruit_gfx_cache_t *cache)
@@ -23,13 +184,38 @@ int adafruit_gfx_cache_init(struct adafruit_gfx_cache_t *cache)
     int ret = 0;
 
     cache->source = NULL;
-    cache->line_addr = 0;
-    cache->initialized = false;
-    cache->dirty = false;
+    cache->stride = SSD1306_LCDWIDTH;
+    memset(&cache->stats, 0, sizeof(cache->stats));
+#ifdef CONFIG_ADAFRUIT_SSD1306_STRIP_MODE
+    cache->origin = 0;
+#endif
+#ifdef SSD1306_CACHE_LINES
+    memset(cache->lines, 0, sizeof(cache->lines));
+    cache->line = NULL;
+    cache->clock = 0;
+#endif
 
     return ret;
 }
 
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_MAPPED
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_HOST
+uint8_t *adafruit_gfx_cache_mapping(const struct device *dev)
+{
+    return cache_host_ram;
+}
+#else
+/*
+ * Where the cache RAM device appears in the address space.  Boards that
+ * only learn the address at run time can override this.
+ */
+__weak uint8_t *adafruit_gfx_cache_mapping(const struct device *dev)
+{
+    return (uint8_t *)CONFIG_ADAFRUIT_SSD1306_CACHE_MAPPED_BASE;
+}
+#endif
+#endif
+
 int adafruit_gfx_cache_source_init(struct adafruit_gfx_cache_t *cache, 
         struct adafruit_gfx_cache_source_t *source, size_t start_offset, 
         const uint8_t *buf)
@@ -37,11 +223,15 @@ int adafruit_gfx_cache_source_init(struct adafruit_gfx_cache_t *cache,
     int ret = 0;
 
 #ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
-    source->dev = device_get_binding(DT_ALIAS("ssd1306_cache"));
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_HOST
+    source->dev = &cache_host_dev;
+#else
+    source->dev = device_get_binding(DT_LABEL(DT_ALIAS(ssd1306_cache)));
     if (source->dev == NULL) {
         LOG_ERR("Can't find the ssd1306_cache RAM device!");
         return -EINVAL;
     }
+#endif
 
     size_t ram_size;
     ret = ram_get_size(source->dev, &ram_size);
@@ -49,12 +239,25 @@ int adafruit_gfx_cache_source_init(struct adafruit_gfx_cache_t *cache,
         return ret;
     }
     
-    if (SSD1306_CACHE_LINE_SIZE + start_offset > ram_size) {
+    if (SSD1306_RAM_MIRROR_SIZE + start_offset > ram_size) {
         LOG_ERR("Cache does not fit in RAM with given offset");
         return -EINVAL;
     }
     
     source->cache_offset = start_offset;
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_MAPPED
+    /* Mapped RAM is used in place, exactly like an internal buffer */
+    source->buffer = adafruit_gfx_cache_mapping(source->dev);
+    if (source->buffer == NULL) {
+        LOG_ERR("The ssd1306_cache RAM device is not memory mapped");
+        return -EINVAL;
+    }
+    source->buffer += start_offset;
+
+    if (buf) {
+        memcpy(source->buffer, buf, SSD1306_RAM_MIRROR_SIZE);
+    }
+#else
     source->buffer = NULL;
     
     if (buf) {
@@ -63,29 +266,24 @@ int adafruit_gfx_cache_source_init(struct adafruit_gfx_cache_t *cache,
             return ret;
         }
 
-        /* Preload the external SRAM with the buffer contents */    
-        size_t i = 0;
-        do {
-            if ((i % SSD1306_CACHE_LINE_SIZE) == 0) {
-                memset(cache->line, 0, SSD1306_CACHE_LINE_SIZE);
+        /* Preload the external SRAM with the buffer contents */
+        size_t i;
+        for (i = 0; i < SSD1306_RAM_MIRROR_SIZE; i += SSD1306_CACHE_LINE_SIZE) {
+            size_t len = SSD1306_RAM_MIRROR_SIZE - i;
+            if (len > SSD1306_CACHE_LINE_SIZE) {
+                len = SSD1306_CACHE_LINE_SIZE;
             }
-            
-            cache->line[i % SSD1306_CACHE_LINE_SIZE] = buf[i];
-            if ((i % SSD1306_CACHE_LINE_SIZE) == SSD1306_CACHE_LINE_SIZE) {
-                cache->dirty = true;
-                ret = adafruit_gfx_cache_save_line(cache, i, 0);
-                if (ret != 0) {
-                    return ret;
-                }
-            }
-            i++;
-        } while (i < SSD1306_RAM_MIRROR_SIZE);
-        
-        if ((i % SSD1306_CACHE_LINE_SIZE) != 0) {
-            cache->dirty = true;
+
+            memset(cache->line->data, 0, SSD1306_CACHE_LINE_SIZE);
+            memcpy(cache->line->data, &buf[i], len);
+            cache->line->dirty = true;
             ret = adafruit_gfx_cache_save_line(cache, i, 0);
+            if (ret != 0) {
+                return ret;
+            }
         }
     }
+#endif
 #else
     source->dev = NULL;
     source->cache_offset = 0;
@@ -101,21 +299,83 @@ int adafruit_gfx_cache_source_init(struct adafruit_gfx_cache_t *cache,
 }
 
 
+#ifdef SSD1306_CACHE_LINES
+/* Write a line back to its own source */
+static int _line_write(struct adafruit_gfx_cache_t *cache, struct adafruit_gfx_cache_line_t *line)
+{
+    int ret;
+
+    cache->stats.writebacks++;
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_WRITE_BEHIND
+    ret = _wb_queue(line->source->dev,
+                    line->addr + line->source->cache_offset,
+                    line->data);
+#else
+    ret = ram_write(line->source->dev, 
+                    line->addr + line->source->cache_offset,
+                    line->data, SSD1306_CACHE_LINE_SIZE);
+#endif
+                    
+    if (ret == 0) {
+        line->initialized = true;
+        line->dirty = false;
+    }
+    return ret;
+}
+#endif
+
+/*
+ * Make source the one the cache works on.  Every source keeps its own line
+ * resident while there are enough lines to go around, so switching back
+ * and forth is just a pointer change.  Otherwise the least recently chosen
+ * source gives up its line, written back first if it is dirty.
+ */
 int adafruit_gfx_cache_source_choose(struct adafruit_gfx_cache_t *cache, 
         struct adafruit_gfx_cache_source_t *source)
 {
-    int ret = 0;
-    if (cache->source && cache->source != source && cache->initialized &&
-        cache->dirty) {
-        ret = adafruit_gfx_cache_flush_line(cache);
-        if (ret != 0) {
-            return ret;
+    if (cache->source == source) {
+        /* Already selected, keep the loaded line (and its dirty data) */
+        return 0;
+    }
+
+#ifdef SSD1306_CACHE_LINES
+    struct adafruit_gfx_cache_line_t *line = NULL;
+
+    for (int i = 0; source && i < ARRAY_SIZE(cache->lines); i++) {
+        struct adafruit_gfx_cache_line_t *l = &cache->lines[i];
+
+        if (l->source == source) {
+            line = l;
+            break;
+        }
+        /* Otherwise prefer an unused line, then the least recently used */
+        if (!line || (line->source && (!l->source || l->used < line->used))) {
+            line = l;
         }
     }
-    
+
+    if (line && line->source != source) {
+        if (line->source && line->initialized && line->dirty) {
+            int ret = _line_write(cache, line);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+
+        line->source = source;
+        line->initialized = false;
+        line->dirty = false;
+    }
+
+    if (line) {
+        line->used = ++cache->clock;
+    }
+    cache->line = line;
+    cache->stats.switches++;
+#endif
+
     cache->source = source;
-    cache->initialized = false;
-    cache->dirty = false;
     
     return 0;
 }
@@ -130,8 +390,8 @@ int adafruit_gfx_cache_get_pixel_addr(struct adafruit_gfx_cache_t *cache, int x,
     }
     
     if (pixel) {
-#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
-        *pixel = &cache->line[pixel_addr];
+#ifdef SSD1306_CACHE_LINES
+        *pixel = &cache->line->data[pixel_addr];
 #else
         if (cache->source && cache->source->buffer) {
             /* Not using external cache, just point at the actual buffer */
@@ -145,6 +405,153 @@ int adafruit_gfx_cache_get_pixel_addr(struct adafruit_gfx_cache_t *cache, int x,
     return ret;
 }
 
+void adafruit_gfx_cache_get_stats(struct adafruit_gfx_cache_t *cache, struct adafruit_gfx_cache_stats_t *stats, bool reset)
+{
+    if (stats) {
+        *stats = cache->stats;
+    }
+
+    if (reset) {
+        memset(&cache->stats, 0, sizeof(cache->stats));
+    }
+}
+
+/*
+ * Like adafruit_gfx_cache_get_pixel_addr(), but also returns how many bytes
+ * starting at that pixel are contiguous in the currently loaded line.  Used
+ * by the bulk writers so they only go back to the cache once per line.
+ */
+int adafruit_gfx_cache_get_span(struct adafruit_gfx_cache_t *cache, int x, int y, uint8_t **pixel, size_t *len)
+{
+    int ret = adafruit_gfx_cache_get_pixel_addr(cache, x, y, pixel);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (len) {
+        *len = SSD1306_CACHE_LINE_SIZE - SSD1306_CACHE_LINE_PIXEL_ADDR(adafruit_gfx_cache_pixel_addr(cache, x, y));
+    }
+
+    return 0;
+}
+
+/*
+ * Copy len bytes starting at pixel (x, y) out of the current source.  With
+ * external RAM only the requested bytes are read from the device instead of
+ * whole lines, except where they overlap the loaded line, which may be
+ * holding dirty data.
+ */
+int adafruit_gfx_cache_read(struct adafruit_gfx_cache_t *cache, int x, int y, uint8_t *buf, size_t len)
+{
+    size_t addr = adafruit_gfx_cache_pixel_addr(cache, x, y);
+
+    if (!cache->source) {
+        return -EINVAL;
+    }
+
+    if (addr + len > SSD1306_RAM_MIRROR_SIZE) {
+        return -EINVAL;
+    }
+
+#ifdef SSD1306_CACHE_LINES
+    if (!cache->source->dev) {
+        return -EINVAL;
+    }
+
+    while (len) {
+        size_t n = len;
+        int ret;
+
+        struct adafruit_gfx_cache_line_t *line = cache->line;
+
+        if (line->initialized && addr >= line->addr &&
+            addr < line->addr + SSD1306_CACHE_LINE_SIZE) {
+            n = min(n, line->addr + SSD1306_CACHE_LINE_SIZE - addr);
+            memcpy(buf, &line->data[addr - line->addr], n);
+        } else {
+            if (line->initialized && line->addr > addr) {
+                n = min(n, line->addr - addr);
+            }
+            ret = _ram_read(cache->source->dev, addr + cache->source->cache_offset, buf, n);
+            if (ret != 0) {
+                return ret;
+            }
+        }
+
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+#else
+    if (!cache->source->buffer) {
+        return -EINVAL;
+    }
+
+    memcpy(buf, &cache->source->buffer[addr], len);
+#endif
+
+    return 0;
+}
+
+/*
+ * Copy len bytes into the current source starting at pixel (x, y), the
+ * counterpart of adafruit_gfx_cache_read().  External RAM is written in one
+ * bulk transfer, and any of the bytes that sit in the loaded line are
+ * updated there too so the line stays coherent.
+ */
+int adafruit_gfx_cache_write(struct adafruit_gfx_cache_t *cache, int x, int y, const uint8_t *buf, size_t len)
+{
+    size_t addr = adafruit_gfx_cache_pixel_addr(cache, x, y);
+
+    if (!cache->source) {
+        return -EINVAL;
+    }
+
+    if (addr + len > SSD1306_RAM_MIRROR_SIZE) {
+        return -EINVAL;
+    }
+
+#ifdef SSD1306_CACHE_LINES
+    if (!cache->source->dev) {
+        return -EINVAL;
+    }
+
+    int ret = 0;
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE_WRITE_BEHIND
+    /* Queued lines would land on top of these bytes */
+    ret = _wb_sync();
+    if (ret != 0) {
+        return ret;
+    }
+#endif
+
+    ret = ram_write(cache->source->dev, addr + cache->source->cache_offset, (uint8_t *)buf, len);
+    if (ret != 0) {
+        return ret;
+    }
+
+    struct adafruit_gfx_cache_line_t *line = cache->line;
+
+    if (line->initialized) {
+        size_t start = max(addr, line->addr);
+        size_t end = min(addr + len, line->addr + SSD1306_CACHE_LINE_SIZE);
+
+        if (start < end) {
+            memcpy(&line->data[start - line->addr], &buf[start - addr], end - start);
+        }
+    }
+#else
+    if (!cache->source->buffer) {
+        return -EINVAL;
+    }
+
+    memcpy(&cache->source->buffer[addr], buf, len);
+#endif
+
+    return 0;
+}
+
 
 void adafruit_gfx_cache_operCache(struct adafruit_gfx_cache_t *cache, int x, int y, oper_t oper_, uint8_t mask)
 {
@@ -174,17 +581,49 @@ void adafruit_gfx_cache_operCache(struct adafruit_gfx_cache_t *cache, int x, int
 
     if (data != origdata) {
         *addr = data;
-        cache->dirty = true;
+        adafruit_gfx_cache_set_dirty(cache, true);
     }
 }
 
 
+#ifdef SSD1306_CACHE_LINES
+/* Bring the line holding (x, y) into the current source's cache line */
+static int _line_miss(struct adafruit_gfx_cache_t *cache, int x, int y)
+{
+    LATENCY_SCOPE(GFX_LATENCY_CACHE_MISS);
+    struct adafruit_gfx_cache_line_t *line = cache->line;
+    int ret;
+
+    if (line->initialized && line->dirty) {
+        /* Trying to read a new line, and the cache line is dirty.  Write it back first, THEN read in the
+         * new data
+         */
+        ret = _line_write(cache, line);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+    
+    line->dirty = false;
+    
+    /* We actually have a cache RAM, read the line from it. */
+    cache->stats.misses++;
+    line->addr = SSD1306_CACHE_LINE_ADDR(adafruit_gfx_cache_pixel_addr(cache, x, y));
+    ret = _ram_read(cache->source->dev, 
+                    line->addr + cache->source->cache_offset,
+                    line->data, SSD1306_CACHE_LINE_SIZE);
+    line->initialized = (ret == 0);
+    return ret;
+}
+#endif
+
 int adafruit_gfx_cache_load_line(struct adafruit_gfx_cache_t *cache, int x, int y, size_t *pixel_addr)
 {
     int ret = 0;
     
-    if (cache->initialized && adafruit_gfx_cache_is_in_line(cache, x, y)) {
+    if (adafruit_gfx_cache_is_in_line(cache, x, y)) {
         /* No need to read anything, it's already cached! */
+        cache->stats.hits++;
         goto done;
     }
     
@@ -192,38 +631,21 @@ int adafruit_gfx_cache_load_line(struct adafruit_gfx_cache_t *cache, int x, int
         return -EINVAL;
     }
     
-#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
+#ifdef SSD1306_CACHE_LINES
     
     if (!cache->source->dev) {
         return -EINVAL;
     }
     
-    if (cache->initialized && cache->dirty) {
-        /* Trying to read a new line, and the cache line is dirty.  Write it back first, THEN read in the
-         * new data
-         */
-        ret = adafruit_gfx_cache_flush_line(cache);
-        if (ret != 0) {
-            return ret;
-        }
-    }
-    
-    cache->dirty = false;
-    
-    /* We actually have a cache RAM, read the line from it. */
-    cache->line_addr = SSD1306_CACHE_LINE_ADDR(x, y);
-    ret = ram_read(cache->source->dev, 
-                   cache->line_addr + cache->source->cache_offset,
-                   cache->line, SSD1306_CACHE_LINE_SIZE);
+    ret = _line_miss(cache, x, y);
     if (ret != 0) {
         return ret;
     }
-    cache->initialized = true;
 #endif
     
 done:
     if (pixel_addr) {
-        *pixel_addr = SSD1306_CACHE_LINE_PIXEL_ADDR(x, y);
+        *pixel_addr = SSD1306_CACHE_LINE_PIXEL_ADDR(adafruit_gfx_cache_pixel_addr(cache, x, y));
     }
     
     return ret;
@@ -243,38 +665,41 @@ int adafruit_gfx_cache_save_line(struct adafruit_gfx_cache_t *cache, int x, int
         return 0;
     }
     
-#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
+#ifdef SSD1306_CACHE_LINES
 
-    size_t line_addr = SSD1306_CACHE_LINE_ADDR(x, y);
+    struct adafruit_gfx_cache_line_t *line = cache->line;
+    size_t line_addr = SSD1306_CACHE_LINE_ADDR(adafruit_gfx_cache_pixel_addr(cache, x, y));
     
-    if (line_addr == cache->line_addr && cache->initialized && !cache->dirty) {
+    if (line_addr == line->addr && line->initialized && !line->dirty) {
         /* The cache is clean, and we are writing to the line where it was read from.
          * Nothing to do, move along.
          */
         return 0;
     }
     
-    cache->line_addr = line_addr;
-    ret = ram_write(cache->source->dev, 
-                    cache->line_addr + cache->source->cache_offset,
-                    cache->line, SSD1306_CACHE_LINE_SIZE);
-                    
-    if (ret == 0) {
-        cache->initialized = true;
-        cache->dirty = false;
-    }
+    line->addr = line_addr;
+    ret = _line_write(cache, line);
 #endif
     return ret;
 }
 
 int adafruit_gfx_cache_flush_line(struct adafruit_gfx_cache_t *cache)
 {
-    return adafruit_gfx_cache_save_line(cache, cache->line_addr, 0);
+#ifdef SSD1306_CACHE_LINES
+    if (cache->line) {
+        return adafruit_gfx_cache_save_line(cache, cache->line->addr, 0);
+    }
+#endif
+    return 0;
 }
 
 int adafruit_gfx_cache_clear_all(struct adafruit_gfx_cache_t *cache)
 {
-    size_t line_addr;
+    return adafruit_gfx_cache_fill_all(cache, 0x00);
+}
+
+int adafruit_gfx_cache_fill_all(struct adafruit_gfx_cache_t *cache, uint8_t value)
+{
     int ret = 0;
     uint8_t *pixel;
   
@@ -283,18 +708,20 @@ int adafruit_gfx_cache_clear_all(struct adafruit_gfx_cache_t *cache)
         return ret;
     }
   
-    memset(pixel, 0, SSD1306_CACHE_LINE_SIZE);
+    adafruit_gfx_rop_fill(pixel, SSD1306_CACHE_LINE_SIZE, value);
   
-    if (cache->source) {
-        for (line_addr = 0; line_addr < SSD1306_RAM_MIRROR_SIZE; line_addr += SSD1306_CACHE_LINE_SIZE) {
-            cache->line_addr = line_addr;
-            cache->dirty = true;
-            ret = adafruit_gfx_cache_flush_line(cache);
-            if (ret != 0) {
-                return ret;
-            }
+#ifdef SSD1306_CACHE_LINES
+    /* Write the filled line over every line of the source */
+    size_t line_addr;
+    for (line_addr = 0; line_addr < SSD1306_RAM_MIRROR_SIZE; line_addr += SSD1306_CACHE_LINE_SIZE) {
+        cache->line->addr = line_addr;
+        cache->line->dirty = true;
+        ret = adafruit_gfx_cache_flush_line(cache);
+        if (ret != 0) {
+            return ret;
         }
     }
+#endif
     
     return 0;
 }
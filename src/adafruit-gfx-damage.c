@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <limits.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-damage.h"
+#include "adafruit-gfx-utils.h"
+
+static void _union(struct adafruit_gfx_damage_t *d, int x, int y, int w, int h)
+{
+    int x1 = max(d->x + d->w, x + w);
+    int y1 = max(d->y + d->h, y + h);
+
+    d->x = min(d->x, x);
+    d->y = min(d->y, y);
+    d->w = x1 - d->x;
+    d->h = y1 - d->y;
+}
+
+/* Overlapping or sharing an edge */
+static bool _touches(const struct adafruit_gfx_damage_t *a, const struct adafruit_gfx_damage_t *b)
+{
+    return a->x <= b->x + b->w && b->x <= a->x + a->w &&
+           a->y <= b->y + b->h && b->y <= a->y + a->h;
+}
+
+/*
+ * The rectangle is merged into one it overlaps or touches, or added.  Once
+ * the list is full it goes into whichever rectangle grows the least.
+ * Merging can make a rectangle overlap another, those are folded together
+ * until none do.
+ */
+int adafruit_gfx_damage_add(struct adafruit_gfx_damage_t *list, int count, int size,
+        int x, int y, int w, int h)
+{
+    int x1 = min(x + w, adafruit_gfx_width());
+    int y1 = min(y + h, adafruit_gfx_height());
+
+    x = max(x, 0);
+    y = max(y, 0);
+    w = x1 - x;
+    h = y1 - y;
+    if (w <= 0 || h <= 0) {
+        return count;
+    }
+
+    struct adafruit_gfx_damage_t r = { x, y, w, h };
+    int best = -1;
+
+    for (int i = 0; i < count && best < 0; i++) {
+        if (_touches(&list[i], &r)) {
+            best = i;
+        }
+    }
+
+    if (best < 0 && count < size) {
+        list[count++] = r;
+        return count;
+    }
+
+    if (best < 0) {
+        int best_growth = INT_MAX;
+
+        for (int i = 0; i < count; i++) {
+            struct adafruit_gfx_damage_t u = list[i];
+
+            _union(&u, x, y, w, h);
+            int growth = u.w * u.h - list[i].w * list[i].h;
+            if (growth < best_growth) {
+                best = i;
+                best_growth = growth;
+            }
+        }
+    }
+    _union(&list[best], x, y, w, h);
+
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (_touches(&list[i], &list[j])) {
+                _union(&list[i], list[j].x, list[j].y, list[j].w, list[j].h);
+                list[j] = list[--count];
+                /* list[i] grew, start over */
+                i = -1;
+                break;
+            }
+        }
+    }
+
+    return count;
+}
+
+int adafruit_gfx_damage_drop(struct adafruit_gfx_damage_t *list, int count, int n)
+{
+    memmove(list, &list[n], (count - n) * sizeof(list[0]));
+    return count - n;
+}
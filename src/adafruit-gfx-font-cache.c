@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <logging/log.h>
+LOG_MODULE_DECLARE(adafruit_ssd1306, CONFIG_DISPLAY_LOG_LEVEL);
+
+#include <zephyr.h>
+#include <device.h>
+#include <string.h>
+#include <sys/byteorder.h>
+#ifdef CONFIG_FLASH
+#include <drivers/flash.h>
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
+#include <drivers/ram.h>
+#endif
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-font.h"
+#include "adafruit-gfx-utils.h"
+
+/*
+ * Glyphs of fonts kept on a device are read on first use into a slot of
+ * this cache, metrics and bitmap together, and the least recently used slot
+ * is recycled when none is free.  Drawing and measuring use the cached
+ * GFXglyph like any in-memory glyph; its bitmapOffset is 0 into the slot's
+ * bitmap.
+ */
+
+struct adafruit_gfx_font_cache_slot_t {
+    const GFXfont *font;    /* NULL while unused */
+    uint32_t index;
+    uint32_t used;
+    GFXglyph glyph;
+    uint8_t bitmap[CONFIG_ADAFRUIT_SSD1306_FONT_CACHE_GLYPH_SIZE];
+};
+
+static struct adafruit_gfx_font_cache_slot_t slots[CONFIG_ADAFRUIT_SSD1306_FONT_CACHE_GLYPHS];
+static uint32_t clock;
+static struct adafruit_gfx_font_cache_stats_t stats;
+
+static int _font_read(const GFXfontStorage *storage, uint32_t offset, uint8_t *buf, size_t len)
+{
+    if (storage->ram) {
+#ifdef CONFIG_ADAFRUIT_SSD1306_CACHE
+        return ram_read(storage->dev, offset, buf, len);
+#endif
+    } else {
+#ifdef CONFIG_FLASH
+        return flash_read(storage->dev, offset, buf, len);
+#endif
+    }
+
+    return -ENOTSUP;
+}
+
+static int _slot_fill(struct adafruit_gfx_font_cache_slot_t *slot, const GFXfont *font,
+        uint32_t index)
+{
+    const GFXfontStorage *storage = font->storage;
+    uint8_t record[GFX_GLYPH_RECORD_SIZE];
+    int ret;
+
+    slot->font = NULL;
+    ret = _font_read(storage, storage->glyph_offset + index * GFX_GLYPH_RECORD_SIZE,
+                     record, sizeof(record));
+    if (ret != 0) {
+        return ret;
+    }
+
+    slot->glyph.bitmapOffset = 0;
+    slot->glyph.width = record[4];
+    slot->glyph.height = record[5];
+    slot->glyph.xAdvance = record[6];
+    slot->glyph.xOffset = (int8_t)record[7];
+    slot->glyph.yOffset = (int8_t)record[8];
+
+    size_t len = (slot->glyph.width * slot->glyph.height + 7) / 8;
+    if (len > sizeof(slot->bitmap)) {
+        /* Keep the advance so the rest of the text doesn't move */
+        stats.too_big++;
+        slot->glyph.width = 0;
+        slot->glyph.height = 0;
+        len = 0;
+    }
+
+    if (len) {
+        ret = _font_read(storage, storage->bitmap_offset + sys_get_le32(record),
+                         slot->bitmap, len);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    slot->font = font;
+    slot->index = index;
+    return 0;
+}
+
+/* NULL if the glyph can't be read */
+GFXglyph *adafruit_gfx_font_cache_glyph(const GFXfont *font, uint32_t index)
+{
+    struct adafruit_gfx_font_cache_slot_t *victim = &slots[0];
+
+    clock++;
+    for (int i = 0; i < ARRAY_SIZE(slots); i++) {
+        struct adafruit_gfx_font_cache_slot_t *slot = &slots[i];
+
+        if (slot->font == font && slot->index == index) {
+            stats.hits++;
+            slot->used = clock;
+            return &slot->glyph;
+        }
+
+        if (victim->font && (!slot->font || slot->used < victim->used)) {
+            victim = slot;
+        }
+    }
+
+    stats.misses++;
+    if (victim->font) {
+        stats.evictions++;
+    }
+
+    int ret = _slot_fill(victim, font, index);
+    if (ret != 0) {
+        stats.errors++;
+        LOG_ERR("Font glyph %u read failed: %d", index, ret);
+        return NULL;
+    }
+
+    victim->used = clock;
+    return &victim->glyph;
+}
+
+const uint8_t *adafruit_gfx_font_cache_bitmap(const GFXglyph *glyph)
+{
+    return CONTAINER_OF(glyph, struct adafruit_gfx_font_cache_slot_t, glyph)->bitmap;
+}
+
+void adafruit_gfx_font_cache_stats(struct adafruit_gfx_font_cache_stats_t *out, bool reset)
+{
+    adafruit_gfx_lock();
+    if (out) {
+        *out = stats;
+    }
+
+    if (reset) {
+        memset(&stats, 0, sizeof(stats));
+    }
+    adafruit_gfx_unlock();
+}
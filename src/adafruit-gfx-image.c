@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "adafruit-gfx-image.h"
+#include "adafruit-gfx-utils.h"
+
+
+void adafruit_gfx_image_decoder_init(struct adafruit_gfx_image_decoder_t *dec,
+        const GFXimage *img)
+{
+    dec->src = img->data;
+    dec->end = img->data + img->size;
+    dec->count = 0;
+    dec->run_byte = 0;
+    dec->literal = false;
+}
+
+static bool _image_next_token(struct adafruit_gfx_image_decoder_t *dec)
+{
+    if (dec->src >= dec->end) {
+        return false;
+    }
+
+    uint8_t ctrl = *dec->src++;
+    if (ctrl & 0x80) {
+        if (dec->src >= dec->end) {
+            /* Truncated stream, run with no data byte */
+            return false;
+        }
+        dec->literal = false;
+        dec->count = (ctrl & 0x7F) + GFX_IMAGE_RUN_MIN;
+        dec->run_byte = *dec->src++;
+    } else {
+        dec->literal = true;
+        dec->count = ctrl + 1;
+    }
+
+    return true;
+}
+
+/*
+ * Decode up to len bytes into out (or just consume them if out is NULL).
+ * Returns the number of bytes produced, which is only short of len once the
+ * compressed stream is exhausted.
+ */
+static size_t _image_decode(struct adafruit_gfx_image_decoder_t *dec,
+        uint8_t *out, size_t len)
+{
+    size_t done = 0;
+
+    while (done < len) {
+        if (dec->count == 0 && !_image_next_token(dec)) {
+            break;
+        }
+
+        size_t chunk = min((size_t)dec->count, len - done);
+        if (dec->literal) {
+            chunk = min(chunk, (size_t)(dec->end - dec->src));
+            if (chunk == 0) {
+                dec->count = 0;
+                break;
+            }
+            if (out) {
+                memcpy(&out[done], dec->src, chunk);
+            }
+            dec->src += chunk;
+        } else if (out) {
+            memset(&out[done], dec->run_byte, chunk);
+        }
+
+        dec->count -= chunk;
+        done += chunk;
+    }
+
+    return done;
+}
+
+size_t adafruit_gfx_image_decode(struct adafruit_gfx_image_decoder_t *dec,
+        uint8_t *out, size_t len)
+{
+    return _image_decode(dec, out, len);
+}
+
+size_t adafruit_gfx_image_skip(struct adafruit_gfx_image_decoder_t *dec, size_t len)
+{
+    return _image_decode(dec, NULL, len);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-latency.h"
+#include "adafruit-gfx-utils.h"
+
+
+static struct adafruit_gfx_latency_t histograms[GFX_LATENCY_COUNT];
+static struct k_spinlock histograms_lock;
+static int primitive_depth;  /* primitives being timed, only the outer one records */
+
+/*
+ * Called with every sample, after it went into its histogram.  Override it
+ * to forward samples to a tracing backend or a logic analyzer pin.
+ */
+__weak void adafruit_gfx_trace_latency(int category, uint32_t us)
+{
+}
+
+/* Bucket 0 is under 1us, bucket n is [2^(n-1), 2^n) us, the last is open */
+static int _bucket(uint32_t us)
+{
+    int bucket = us ? 32 - __builtin_clz(us) : 0;
+
+    return min(bucket, CONFIG_ADAFRUIT_SSD1306_LATENCY_BUCKETS - 1);
+}
+
+static void _record(int category, uint32_t cycles)
+{
+    struct adafruit_gfx_latency_t *hist = &histograms[category];
+    uint32_t us = k_cyc_to_us_floor32(cycles);
+    k_spinlock_key_t key = k_spin_lock(&histograms_lock);
+
+    hist->count++;
+    hist->total_us += us;
+    hist->max_us = max(hist->max_us, us);
+    hist->buckets[_bucket(us)]++;
+    k_spin_unlock(&histograms_lock, key);
+
+    adafruit_gfx_trace_latency(category, us);
+}
+
+void adafruit_gfx_latency_enter(struct adafruit_gfx_latency_scope_t *scope)
+{
+    if (scope->category >= GFX_LATENCY_LINE && primitive_depth++ > 0) {
+        return;
+    }
+    scope->start = k_cycle_get_32();
+}
+
+void adafruit_gfx_latency_exit(struct adafruit_gfx_latency_scope_t *scope)
+{
+    if (scope->category >= GFX_LATENCY_LINE && --primitive_depth > 0) {
+        return;
+    }
+    _record(scope->category, k_cycle_get_32() - scope->start);
+}
+
+void adafruit_gfx_latency(int category, struct adafruit_gfx_latency_t *hist, bool reset)
+{
+    if (category < 0 || category >= GFX_LATENCY_COUNT) {
+        if (hist) {
+            memset(hist, 0, sizeof(*hist));
+        }
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&histograms_lock);
+
+    if (hist) {
+        *hist = histograms[category];
+    }
+
+    if (reset) {
+        memset(&histograms[category], 0, sizeof(histograms[category]));
+    }
+    k_spin_unlock(&histograms_lock, key);
+}
+
+/*
+ * The sample at the given percentile, rounded up to the top of its bucket
+ * and never more than the largest sample seen.
+ */
+uint32_t adafruit_gfx_latency_percentile(const struct adafruit_gfx_latency_t *hist, int percent)
+{
+    uint32_t rank = ((uint64_t)hist->count * clamp(percent, 0, 100) + 99) / 100;
+    uint32_t seen = 0;
+
+    if (hist->count == 0) {
+        return 0;
+    }
+
+    rank = max(rank, 1U);
+    for (int i = 0; i < CONFIG_ADAFRUIT_SSD1306_LATENCY_BUCKETS - 1; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            return min((1U << i) - 1, hist->max_us);
+        }
+    }
+
+    return hist->max_us;
+}
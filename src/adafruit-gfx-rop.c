@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "adafruit-gfx-rop.h"
+
+
+/*
+ * Word type for the aligned loops.  may_alias lets it walk the byte
+ * buffers; the unaligned variant is only used to read a source that isn't
+ * aligned the same way as the destination.
+ */
+#ifdef CONFIG_64BIT
+typedef uint64_t __attribute__((__may_alias__)) rop_word_t;
+typedef uint64_t __attribute__((__may_alias__, __aligned__(1))) rop_uword_t;
+#else
+typedef uint32_t __attribute__((__may_alias__)) rop_word_t;
+typedef uint32_t __attribute__((__may_alias__, __aligned__(1))) rop_uword_t;
+#endif
+
+#define ROP_WORD_SIZE       sizeof(rop_word_t)
+#define ROP_REPEAT(b)       (((rop_word_t)-1 / 0xFF) * (uint8_t)(b))
+
+static inline uint8_t _rop_byte(uint8_t dst, uint8_t src, rop_t rop)
+{
+    switch (rop) {
+        case ROP_COPY:
+            return src;
+        case ROP_OR:
+            return dst | src;
+        case ROP_AND:
+            return dst & src;
+        case ROP_XOR:
+            return dst ^ src;
+        case ROP_ANDNOT:
+            return dst & ~src;
+    }
+    return dst;
+}
+
+/* Bytes to handle one at a time before dst is word aligned */
+static inline size_t _rop_head(const uint8_t *dst, size_t len)
+{
+    size_t head = (ROP_WORD_SIZE - ((uintptr_t)dst & (ROP_WORD_SIZE - 1))) & (ROP_WORD_SIZE - 1);
+    return head < len ? head : len;
+}
+
+void adafruit_gfx_rop_apply(uint8_t *dst, size_t len, rop_t rop, uint8_t value)
+{
+    size_t head = _rop_head(dst, len);
+    size_t i;
+
+    for (i = 0; i < head; i++) {
+        dst[i] = _rop_byte(dst[i], value, rop);
+    }
+    dst += head;
+    len -= head;
+
+    rop_word_t *w = (rop_word_t *)dst;
+    rop_word_t v = ROP_REPEAT(value);
+    size_t words = len / ROP_WORD_SIZE;
+
+    /* One loop per operation keeps each of them trivially vectorizable */
+    switch (rop) {
+        case ROP_COPY:
+            for (i = 0; i < words; i++) {
+                w[i] = v;
+            }
+            break;
+        case ROP_OR:
+            for (i = 0; i < words; i++) {
+                w[i] |= v;
+            }
+            break;
+        case ROP_AND:
+            for (i = 0; i < words; i++) {
+                w[i] &= v;
+            }
+            break;
+        case ROP_XOR:
+            for (i = 0; i < words; i++) {
+                w[i] ^= v;
+            }
+            break;
+        case ROP_ANDNOT:
+            for (i = 0; i < words; i++) {
+                w[i] &= ~v;
+            }
+            break;
+    }
+
+    for (i = words * ROP_WORD_SIZE; i < len; i++) {
+        dst[i] = _rop_byte(dst[i], value, rop);
+    }
+}
+
+void adafruit_gfx_rop_compose(uint8_t *dst, const uint8_t *src, size_t len, rop_t rop)
+{
+    size_t head = _rop_head(dst, len);
+    size_t i;
+
+    for (i = 0; i < head; i++) {
+        dst[i] = _rop_byte(dst[i], src[i], rop);
+    }
+    dst += head;
+    src += head;
+    len -= head;
+
+    rop_word_t *w = (rop_word_t *)dst;
+    const rop_uword_t *s = (const rop_uword_t *)src;
+    size_t words = len / ROP_WORD_SIZE;
+
+    switch (rop) {
+        case ROP_COPY:
+            memcpy(dst, src, words * ROP_WORD_SIZE);
+            break;
+        case ROP_OR:
+            for (i = 0; i < words; i++) {
+                w[i] |= s[i];
+            }
+            break;
+        case ROP_AND:
+            for (i = 0; i < words; i++) {
+                w[i] &= s[i];
+            }
+            break;
+        case ROP_XOR:
+            for (i = 0; i < words; i++) {
+                w[i] ^= s[i];
+            }
+            break;
+        case ROP_ANDNOT:
+            for (i = 0; i < words; i++) {
+                w[i] &= ~s[i];
+            }
+            break;
+    }
+
+    for (i = words * ROP_WORD_SIZE; i < len; i++) {
+        dst[i] = _rop_byte(dst[i], src[i], rop);
+    }
+}
+
+void adafruit_gfx_rop_blend(uint8_t *dst, const uint8_t *src, size_t len, uint8_t mask)
+{
+    if (mask == 0xFF) {
+        adafruit_gfx_rop_copy(dst, src, len);
+        return;
+    }
+
+    size_t head = _rop_head(dst, len);
+    size_t i;
+
+    for (i = 0; i < head; i++) {
+        dst[i] = (dst[i] & ~mask) | (src[i] & mask);
+    }
+    dst += head;
+    src += head;
+    len -= head;
+
+    rop_word_t *w = (rop_word_t *)dst;
+    const rop_uword_t *s = (const rop_uword_t *)src;
+    rop_word_t m = ROP_REPEAT(mask);
+    size_t words = len / ROP_WORD_SIZE;
+
+    for (i = 0; i < words; i++) {
+        w[i] = (w[i] & ~m) | (s[i] & m);
+    }
+
+    for (i = words * ROP_WORD_SIZE; i < len; i++) {
+        dst[i] = (dst[i] & ~mask) | (src[i] & mask);
+    }
+}
+
+/*
+ * Both shifts move every byte lane by the same amount, masking off the
+ * bits that crossed into the neighbouring lane, and OR in the rows coming
+ * from the next page row.
+ */
+void adafruit_gfx_rop_shift_up(uint8_t *dst, const uint8_t *below, size_t len, int n)
+{
+    if (n <= 0 || n > 7) {
+        return;
+    }
+
+    uint8_t keep = 0xFF >> n;
+    uint8_t carry = 0xFF << (8 - n);
+    size_t head = _rop_head(dst, len);
+    size_t i;
+
+    for (i = 0; i < head; i++) {
+        dst[i] = ((dst[i] >> n) & keep) | (below ? (below[i] << (8 - n)) & carry : 0);
+    }
+    dst += head;
+    len -= head;
+
+    rop_word_t *w = (rop_word_t *)dst;
+    rop_word_t wkeep = ROP_REPEAT(keep);
+    rop_word_t wcarry = ROP_REPEAT(carry);
+    size_t words = len / ROP_WORD_SIZE;
+
+    if (below) {
+        below += head;
+        const rop_uword_t *s = (const rop_uword_t *)below;
+        for (i = 0; i < words; i++) {
+            w[i] = ((w[i] >> n) & wkeep) | ((s[i] << (8 - n)) & wcarry);
+        }
+    } else {
+        for (i = 0; i < words; i++) {
+            w[i] = (w[i] >> n) & wkeep;
+        }
+    }
+
+    for (i = words * ROP_WORD_SIZE; i < len; i++) {
+        dst[i] = ((dst[i] >> n) & keep) | (below ? (below[i] << (8 - n)) & carry : 0);
+    }
+}
+
+void adafruit_gfx_rop_shift_down(uint8_t *dst, const uint8_t *above, size_t len, int n)
+{
+    if (n <= 0 || n > 7) {
+        return;
+    }
+
+    uint8_t keep = 0xFF << n;
+    uint8_t carry = 0xFF >> (8 - n);
+    size_t head = _rop_head(dst, len);
+    size_t i;
+
+    for (i = 0; i < head; i++) {
+        dst[i] = ((dst[i] << n) & keep) | (above ? (above[i] >> (8 - n)) & carry : 0);
+    }
+    dst += head;
+    len -= head;
+
+    rop_word_t *w = (rop_word_t *)dst;
+    rop_word_t wkeep = ROP_REPEAT(keep);
+    rop_word_t wcarry = ROP_REPEAT(carry);
+    size_t words = len / ROP_WORD_SIZE;
+
+    if (above) {
+        above += head;
+        const rop_uword_t *s = (const rop_uword_t *)above;
+        for (i = 0; i < words; i++) {
+            w[i] = ((w[i] << n) & wkeep) | ((s[i] >> (8 - n)) & wcarry);
+        }
+    } else {
+        for (i = 0; i < words; i++) {
+            w[i] = (w[i] << n) & wkeep;
+        }
+    }
+
+    for (i = words * ROP_WORD_SIZE; i < len; i++) {
+        dst[i] = ((dst[i] << n) & keep) | (above ? (above[i] >> (8 - n)) & carry : 0);
+    }
+}
+
+void adafruit_gfx_rop_transpose8(const uint8_t *in, uint8_t *out)
+{
+    uint64_t x = 0;
+    uint64_t t;
+    int i;
+
+    /* Bit j of byte i sits at bit 8i + j, transposing swaps i and j */
+    for (i = 0; i < 8; i++) {
+        x |= (uint64_t)in[i] << (i * 8);
+    }
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x ^= t ^ (t << 28);
+
+    for (i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(x >> (i * 8));
+    }
+}
@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-scene.h"
+#include "adafruit-gfx-utils.h"
+
+/* The caller's text settings, put back after a label is measured or drawn */
+struct scene_text_t {
+    const GFXfont *font;
+    int size;
+    int color;
+    int bg;
+};
+
+static void _text_save(struct scene_text_t *text)
+{
+    text->font = adafruit_gfx_getFont();
+    text->size = adafruit_gfx_getTextSize();
+    adafruit_gfx_getTextColor(&text->color, &text->bg);
+}
+
+static void _text_restore(const struct scene_text_t *text)
+{
+    adafruit_gfx_setFont(text->font);
+    adafruit_gfx_setTextSize(text->size);
+    adafruit_gfx_setTextColor(text->color, text->bg);
+}
+
+static bool _overlaps(int x0, int y0, int w0, int h0, int x1, int y1, int w1, int h1)
+{
+    return x0 < x1 + w1 && x1 < x0 + w0 && y0 < y1 + h1 && y1 < y0 + h0;
+}
+
+/* Add a rectangle to the damage list, see adafruit-gfx-damage.h */
+void adafruit_gfx_scene_invalidate(struct adafruit_gfx_scene_t *scene, int x, int y, int w, int h)
+{
+    scene->damage_count = adafruit_gfx_damage_add(scene->damage, scene->damage_count,
+                                                  ARRAY_SIZE(scene->damage), x, y, w, h);
+}
+
+/* Bounds of what an object draws, measured with its current properties */
+static void _obj_bounds(struct adafruit_gfx_obj_t *obj)
+{
+    int x = obj->x;
+    int y = obj->y;
+    int w = obj->w;
+    int h = obj->h;
+    struct scene_text_t text;
+
+    switch (obj->type) {
+        case GFX_OBJ_LINE:
+            x = min(obj->x, obj->line.x1);
+            y = min(obj->y, obj->line.y1);
+            w = _abs(obj->line.x1 - obj->x) + 1;
+            h = _abs(obj->line.y1 - obj->y) + 1;
+            break;
+        case GFX_OBJ_LABEL:
+            _text_save(&text);
+            adafruit_gfx_setFont(obj->label.font);
+            adafruit_gfx_setTextSize(obj->label.size);
+            if (!obj->label.text ||
+                adafruit_gfx_drawString(obj->x, obj->y, obj->label.text,
+                                        obj->label.flags | GFX_STRING_MEASURE,
+                                        &x, &y, &w, &h) <= 0) {
+                w = 0;
+            }
+            _text_restore(&text);
+            break;
+        default:
+            break;
+    }
+
+    if (!obj->visible || w <= 0 || h <= 0) {
+        w = 0;
+        h = 0;
+    }
+
+    obj->bx = x;
+    obj->by = y;
+    obj->bw = w;
+    obj->bh = h;
+}
+
+/* Damage an object's current bounds */
+static void _obj_damage(struct adafruit_gfx_obj_t *obj)
+{
+    if (obj->scene && obj->bw) {
+        adafruit_gfx_scene_invalidate(obj->scene, obj->bx, obj->by, obj->bw, obj->bh);
+    }
+}
+
+/* After a property changed: the new bounds are damaged too */
+static void _obj_changed(struct adafruit_gfx_obj_t *obj)
+{
+    _obj_bounds(obj);
+    _obj_damage(obj);
+}
+
+static void _obj_draw(struct adafruit_gfx_obj_t *obj)
+{
+    struct scene_text_t text;
+    int r;
+
+    switch (obj->type) {
+        case GFX_OBJ_RECT:
+            /* The round rect corners spill out of the bounds past w/2 or h/2 */
+            r = min((int)obj->rect.radius, min(obj->w, obj->h) / 2);
+            if (obj->rect.fill) {
+                adafruit_gfx_fillRoundRect(obj->x, obj->y, obj->w, obj->h, r, obj->color);
+            } else {
+                adafruit_gfx_drawRoundRect(obj->x, obj->y, obj->w, obj->h, r, obj->color);
+            }
+            break;
+        case GFX_OBJ_LINE:
+            adafruit_gfx_drawLine(obj->x, obj->y, obj->line.x1, obj->line.y1, obj->color);
+            break;
+        case GFX_OBJ_LABEL:
+            _text_save(&text);
+            adafruit_gfx_setFont(obj->label.font);
+            adafruit_gfx_setTextSize(obj->label.size);
+            adafruit_gfx_setTextColor(obj->color, obj->bg);
+            adafruit_gfx_drawString(obj->x, obj->y, obj->label.text, obj->label.flags,
+                                    NULL, NULL, NULL, NULL);
+            _text_restore(&text);
+            break;
+        case GFX_OBJ_BITMAP:
+            adafruit_gfx_drawBitmap(obj->x, obj->y, (uint8_t *)obj->bitmap.data, obj->w, obj->h,
+                                    obj->color, obj->bg);
+            break;
+    }
+}
+
+void adafruit_gfx_scene_init(struct adafruit_gfx_scene_t *scene, int bg)
+{
+    scene->objs = NULL;
+    scene->bg = bg;
+    scene->damage_count = 0;
+    adafruit_gfx_scene_invalidate(scene, 0, 0, adafruit_gfx_width(), adafruit_gfx_height());
+}
+
+/* Add an object on top of everything already in the scene */
+void adafruit_gfx_scene_add(struct adafruit_gfx_scene_t *scene, struct adafruit_gfx_obj_t *obj)
+{
+    struct adafruit_gfx_obj_t **link = &scene->objs;
+
+    while (*link) {
+        link = &(*link)->next;
+    }
+    *link = obj;
+    obj->next = NULL;
+    obj->scene = scene;
+    _obj_changed(obj);
+}
+
+void adafruit_gfx_scene_remove(struct adafruit_gfx_obj_t *obj)
+{
+    struct adafruit_gfx_scene_t *scene = obj->scene;
+
+    if (!scene) {
+        return;
+    }
+
+    _obj_damage(obj);
+    for (struct adafruit_gfx_obj_t **link = &scene->objs; *link; link = &(*link)->next) {
+        if (*link == obj) {
+            *link = obj->next;
+            break;
+        }
+    }
+    obj->next = NULL;
+    obj->scene = NULL;
+}
+
+/*
+ * Redraw the damaged rectangles and send them to the panel.  Each one is
+ * cleared to the background, then every visible object overlapping it is
+ * drawn in order with the clip set to the rectangle.  Rectangles that
+ * fail to go out stay damaged, for the next update to try again.  The
+ * caller's clip and text settings are left as they were.
+ */
+int adafruit_gfx_scene_update(struct adafruit_gfx_scene_t *scene)
+{
+    int cx, cy, cw, ch;
+    int sent = 0;
+    int ret = 0;
+
+    adafruit_gfx_getClipRect(&cx, &cy, &cw, &ch);
+
+    for (; sent < scene->damage_count; sent++) {
+        struct adafruit_gfx_damage_t *d = &scene->damage[sent];
+
+        adafruit_gfx_setClipRect(d->x, d->y, d->w, d->h);
+        adafruit_gfx_fillRect(d->x, d->y, d->w, d->h, scene->bg);
+
+        for (struct adafruit_gfx_obj_t *obj = scene->objs; obj; obj = obj->next) {
+            if (obj->bw && _overlaps(obj->bx, obj->by, obj->bw, obj->bh, d->x, d->y, d->w, d->h)) {
+                _obj_draw(obj);
+            }
+        }
+
+        ret = adafruit_gfx_displayRegion(d->x, d->y, d->w, d->h);
+        if (ret != 0) {
+            break;
+        }
+    }
+
+    scene->damage_count = adafruit_gfx_damage_drop(scene->damage, scene->damage_count, sent);
+    adafruit_gfx_setClipRect(cx, cy, cw, ch);
+    return ret;
+}
+
+static void _obj_init(struct adafruit_gfx_obj_t *obj, int type, int x, int y, int w, int h,
+        int color, int bg)
+{
+    memset(obj, 0, sizeof(*obj));
+    obj->type = type;
+    obj->visible = true;
+    obj->x = x;
+    obj->y = y;
+    obj->w = w;
+    obj->h = h;
+    obj->color = color;
+    obj->bg = bg;
+}
+
+void adafruit_gfx_rect_init(struct adafruit_gfx_obj_t *obj, int x, int y, int w, int h,
+        int radius, bool fill, int color)
+{
+    _obj_init(obj, GFX_OBJ_RECT, x, y, w, h, color, color);
+    obj->rect.radius = radius;
+    obj->rect.fill = fill;
+}
+
+void adafruit_gfx_line_init(struct adafruit_gfx_obj_t *obj, int x0, int y0, int x1, int y1,
+        int color)
+{
+    _obj_init(obj, GFX_OBJ_LINE, x0, y0, 0, 0, color, color);
+    obj->line.x1 = x1;
+    obj->line.y1 = y1;
+}
+
+void adafruit_gfx_label_init(struct adafruit_gfx_obj_t *obj, int x, int y, const char *text,
+        const GFXfont *font, int size, int flags, int color, int bg)
+{
+    _obj_init(obj, GFX_OBJ_LABEL, x, y, 0, 0, color, bg);
+    obj->label.text = text;
+    obj->label.font = font;
+    obj->label.size = max(size, 1);
+    obj->label.flags = flags;
+}
+
+void adafruit_gfx_bitmap_init(struct adafruit_gfx_obj_t *obj, int x, int y,
+        const uint8_t *data, int w, int h, int color, int bg)
+{
+    _obj_init(obj, GFX_OBJ_BITMAP, x, y, w, h, color, bg);
+    obj->bitmap.data = data;
+}
+
+/* Lines move both ends */
+void adafruit_gfx_obj_set_pos(struct adafruit_gfx_obj_t *obj, int x, int y)
+{
+    _obj_damage(obj);
+    if (obj->type == GFX_OBJ_LINE) {
+        obj->line.x1 += x - obj->x;
+        obj->line.y1 += y - obj->y;
+    }
+    obj->x = x;
+    obj->y = y;
+    _obj_changed(obj);
+}
+
+void adafruit_gfx_obj_set_size(struct adafruit_gfx_obj_t *obj, int w, int h)
+{
+    _obj_damage(obj);
+    obj->w = w;
+    obj->h = h;
+    _obj_changed(obj);
+}
+
+void adafruit_gfx_obj_set_color(struct adafruit_gfx_obj_t *obj, int color, int bg)
+{
+    obj->color = color;
+    obj->bg = bg;
+    _obj_changed(obj);
+}
+
+void adafruit_gfx_obj_set_visible(struct adafruit_gfx_obj_t *obj, bool visible)
+{
+    if (obj->visible == visible) {
+        return;
+    }
+
+    _obj_damage(obj);
+    obj->visible = visible;
+    _obj_changed(obj);
+}
+
+void adafruit_gfx_line_set_end(struct adafruit_gfx_obj_t *obj, int x1, int y1)
+{
+    _obj_damage(obj);
+    obj->line.x1 = x1;
+    obj->line.y1 = y1;
+    _obj_changed(obj);
+}
+
+void adafruit_gfx_label_set_text(struct adafruit_gfx_obj_t *obj, const char *text)
+{
+    _obj_damage(obj);
+    obj->label.text = text;
+    _obj_changed(obj);
+}
+
+void adafruit_gfx_bitmap_set_data(struct adafruit_gfx_obj_t *obj, const uint8_t *data)
+{
+    obj->bitmap.data = data;
+    _obj_changed(obj);
+}
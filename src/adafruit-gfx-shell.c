@@ -0,0 +1,310 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <stdlib.h>
+#include <string.h>
+#include <shell/shell.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-utils.h"
+
+/*
+ * gfx bench [primitive] [iterations]
+ *
+ * Runs each workload on the real panel and RAM device: the draw calls are
+ * timed on their own, then one adafruit_gfx_display() flushes the result.
+ * Coordinates come from a fixed seed so runs are comparable between builds
+ * and boards.
+ */
+
+#define GFX_BENCH_ITERATIONS    100
+
+static uint32_t bench_seed;
+
+static int _rnd(int n)
+{
+    bench_seed = bench_seed * 1103515245 + 12345;
+    return (bench_seed >> 16) % n;
+}
+
+static void _bench_pixel(void)
+{
+    adafruit_gfx_drawPixel(_rnd(adafruit_gfx_width()), _rnd(adafruit_gfx_height()), INVERSE);
+}
+
+static void _bench_hline(void)
+{
+    adafruit_gfx_drawFastHLine(_rnd(32), _rnd(adafruit_gfx_height()), 64, INVERSE);
+}
+
+static void _bench_vline(void)
+{
+    adafruit_gfx_drawFastVLine(_rnd(adafruit_gfx_width()), _rnd(16), 32, INVERSE);
+}
+
+static void _bench_line(void)
+{
+    adafruit_gfx_drawLine(_rnd(adafruit_gfx_width()), _rnd(adafruit_gfx_height()),
+                          _rnd(adafruit_gfx_width()), _rnd(adafruit_gfx_height()), INVERSE);
+}
+
+static void _bench_rect(void)
+{
+    adafruit_gfx_fillRect(_rnd(adafruit_gfx_width() - 24), _rnd(adafruit_gfx_height() - 16),
+                          24, 16, INVERSE);
+}
+
+static void _bench_circle(void)
+{
+    adafruit_gfx_drawCircle(_rnd(adafruit_gfx_width()), _rnd(adafruit_gfx_height()), 12, INVERSE);
+}
+
+static void _bench_fillcircle(void)
+{
+    adafruit_gfx_fillCircle(_rnd(adafruit_gfx_width()), _rnd(adafruit_gfx_height()), 12, WHITE);
+}
+
+static void _bench_text(void)
+{
+    adafruit_gfx_setFont(NULL);
+    adafruit_gfx_setTextSize(1);
+    adafruit_gfx_setTextColor(WHITE, BLACK);
+    adafruit_gfx_drawString(_rnd(adafruit_gfx_width() - 60), _rnd(adafruit_gfx_height() - 8),
+                            "Bench 123", 0, NULL, NULL, NULL, NULL);
+}
+
+/* A typical status screen, redrawn from scratch */
+static void _bench_scene(void)
+{
+    int w = adafruit_gfx_width();
+    int h = adafruit_gfx_height();
+
+    adafruit_gfx_fillScreen(BLACK);
+    adafruit_gfx_drawRoundRect(0, 0, w, h, 4, WHITE);
+    adafruit_gfx_fillRect(2, 2, w - 4, 10, WHITE);
+    adafruit_gfx_setFont(NULL);
+    adafruit_gfx_setTextSize(1);
+    adafruit_gfx_setTextColor(BLACK, WHITE);
+    adafruit_gfx_drawString(w / 2, 3, "STATUS", GFX_ALIGN_CENTER, NULL, NULL, NULL, NULL);
+    adafruit_gfx_setTextColor(WHITE, BLACK);
+    adafruit_gfx_drawString(4, 16, "12:34:56", 0, NULL, NULL, NULL, NULL);
+    adafruit_gfx_drawFastHLine(4, h - 12, w - 8, WHITE);
+    adafruit_gfx_fillRect(4, h - 9, _rnd(w - 8) + 1, 6, WHITE);
+    adafruit_gfx_fillCircle(w - 12, 20, 5, WHITE);
+}
+
+static void _bench_flush(void)
+{
+    adafruit_gfx_display();
+}
+
+static const struct {
+    const char *name;
+    void (*run)(void);
+} benches[] = {
+    { "pixel", _bench_pixel },
+    { "hline", _bench_hline },
+    { "vline", _bench_vline },
+    { "line", _bench_line },
+    { "rect", _bench_rect },
+    { "circle", _bench_circle },
+    { "fillcircle", _bench_fillcircle },
+    { "text", _bench_text },
+    { "scene", _bench_scene },
+    { "flush", _bench_flush },
+};
+
+static void _bench_one(const struct shell *shell, int i, uint32_t iterations)
+{
+    struct adafruit_gfx_bus_stats_t bus;
+    struct adafruit_gfx_cache_stats_t cache;
+
+    bench_seed = 1;
+    adafruit_gfx_resetClip();
+    adafruit_gfx_clearDisplay();
+    adafruit_gfx_bus_stats(NULL, true);
+    adafruit_gfx_cache_stats(NULL, true);
+
+    uint32_t start = k_cycle_get_32();
+    for (uint32_t n = 0; n < iterations; n++) {
+        benches[i].run();
+    }
+    uint32_t cycles = k_cycle_get_32() - start;
+    adafruit_gfx_cache_stats(&cache, false);
+
+    start = k_cycle_get_32();
+    int ret = adafruit_gfx_display();
+    uint32_t flush = k_cycle_get_32() - start;
+    adafruit_gfx_bus_stats(&bus, false);
+
+    shell_print(shell, "%-10s %9u %8u %6u/%u/%u %8u %6u%s",
+                benches[i].name, cycles / iterations,
+                (uint32_t)k_cyc_to_us_floor64(cycles / iterations),
+                cache.hits, cache.misses, cache.writebacks,
+                (uint32_t)k_cyc_to_us_floor64(flush),
+                bus.command_bytes + bus.data_bytes,
+                ret ? " (flush failed)" : "");
+}
+
+static int cmd_gfx_bench(const struct shell *shell, size_t argc, char **argv)
+{
+    const char *name = argc > 1 ? argv[1] : "all";
+    uint32_t iterations = GFX_BENCH_ITERATIONS;
+    bool found = false;
+
+    if (argc > 2) {
+        iterations = strtoul(argv[2], NULL, 0);
+        if (iterations == 0) {
+            shell_error(shell, "Bad iteration count: %s", argv[2]);
+            return -EINVAL;
+        }
+    }
+
+    adafruit_gfx_lock();
+    shell_print(shell, "%u iterations, %u cycles/s", iterations, sys_clock_hw_cycles_per_sec());
+    shell_print(shell, "%-10s %9s %8s %12s %8s %6s",
+                "bench", "cycles/op", "us/op", "hit/miss/wb", "flush us", "bytes");
+
+    for (int i = 0; i < ARRAY_SIZE(benches); i++) {
+        if (!strcmp(name, "all") || !strcmp(name, benches[i].name)) {
+            _bench_one(shell, i, iterations);
+            found = true;
+        }
+    }
+    adafruit_gfx_unlock();
+
+    if (!found) {
+        shell_error(shell, "Unknown primitive: %s", name);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int cmd_gfx_stats(const struct shell *shell, size_t argc, char **argv)
+{
+    struct adafruit_gfx_bus_stats_t bus;
+    struct adafruit_gfx_cache_stats_t cache;
+
+    adafruit_gfx_bus_stats(&bus, false);
+    adafruit_gfx_cache_stats(&cache, false);
+
+    shell_print(shell, "bus:   %u transactions, %u command bytes, %u data bytes, %u frames",
+                bus.transactions, bus.command_bytes, bus.data_bytes, bus.frames);
+    shell_print(shell, "cache: %u hits, %u misses, %u writebacks, %u source switches",
+                cache.hits, cache.misses, cache.writebacks, cache.switches);
+#ifdef CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL
+    struct adafruit_gfx_font_cache_stats_t font;
+
+    adafruit_gfx_font_cache_stats(&font, false);
+    shell_print(shell, "font:  %u hits, %u misses, %u evictions, %u too big, %u errors",
+                font.hits, font.misses, font.evictions, font.too_big, font.errors);
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+    struct adafruit_gfx_arena_stats_t arena;
+
+    adafruit_gfx_arena_stats(&arena, false);
+    shell_print(shell, "arena: %u hits, %u renders, %u resets, %u too big, %u bytes used",
+                arena.hits, arena.renders, arena.resets, arena.too_big, arena.used);
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_FRAME_GOVERNOR
+    struct adafruit_gfx_frame_stats_t frame;
+
+    adafruit_gfx_frame_stats(&frame, false);
+    shell_print(shell, "frame: %u requests, %u coalesced, %u sent, %u errors, %u.%02u fps",
+                frame.requests, frame.coalesced, frame.frames, frame.errors,
+                frame.fps_x100 / 100, frame.fps_x100 % 100);
+#endif
+
+    return 0;
+}
+
+static int cmd_gfx_stats_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    adafruit_gfx_bus_stats(NULL, true);
+    adafruit_gfx_cache_stats(NULL, true);
+#ifdef CONFIG_ADAFRUIT_SSD1306_FONT_EXTERNAL
+    adafruit_gfx_font_cache_stats(NULL, true);
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_ARENA
+    adafruit_gfx_arena_stats(NULL, true);
+#endif
+#ifdef CONFIG_ADAFRUIT_SSD1306_FRAME_GOVERNOR
+    adafruit_gfx_frame_stats(NULL, true);
+#endif
+
+    return 0;
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_LATENCY
+static const char *latency_names[GFX_LATENCY_COUNT] = {
+    [GFX_LATENCY_DISPLAY] = "display",
+    [GFX_LATENCY_BUS] = "bus",
+    [GFX_LATENCY_CACHE_MISS] = "cache miss",
+    [GFX_LATENCY_LINE] = "line",
+    [GFX_LATENCY_RECT] = "rect",
+    [GFX_LATENCY_CIRCLE] = "circle",
+    [GFX_LATENCY_TRIANGLE] = "triangle",
+    [GFX_LATENCY_BITMAP] = "bitmap",
+    [GFX_LATENCY_TEXT] = "text",
+};
+
+static int cmd_gfx_latency(const struct shell *shell, size_t argc, char **argv)
+{
+    struct adafruit_gfx_latency_t hist;
+
+    shell_print(shell, "%-10s %8s %8s %8s %8s %8s", "latency", "count", "avg us", "p50 us",
+                "p99 us", "max us");
+    for (int i = 0; i < GFX_LATENCY_COUNT; i++) {
+        adafruit_gfx_latency(i, &hist, false);
+        if (hist.count == 0) {
+            continue;
+        }
+        shell_print(shell, "%-10s %8u %8u %8u %8u %8u", latency_names[i], hist.count,
+                    hist.total_us / hist.count,
+                    adafruit_gfx_latency_percentile(&hist, 50),
+                    adafruit_gfx_latency_percentile(&hist, 99), hist.max_us);
+    }
+
+    return 0;
+}
+
+static int cmd_gfx_latency_reset(const struct shell *shell, size_t argc, char **argv)
+{
+    for (int i = 0; i < GFX_LATENCY_COUNT; i++) {
+        adafruit_gfx_latency(i, NULL, true);
+    }
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_gfx_latency,
+    SHELL_CMD(reset, NULL, "Empty the histograms", cmd_gfx_latency_reset),
+    SHELL_SUBCMD_SET_END
+);
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_gfx_stats,
+    SHELL_CMD(reset, NULL, "Zero all counters", cmd_gfx_stats_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_gfx,
+    SHELL_CMD_ARG(bench, NULL,
+                  "Time draw workloads and the frame flush (overwrites the screen)\n"
+                  "usage: gfx bench [all|pixel|hline|vline|line|rect|circle|"
+                  "fillcircle|text|scene|flush] [iterations]",
+                  cmd_gfx_bench, 1, 2),
+    SHELL_CMD(stats, &sub_gfx_stats, "Bus, cache and frame counters", cmd_gfx_stats),
+#ifdef CONFIG_ADAFRUIT_SSD1306_LATENCY
+    SHELL_CMD(latency, &sub_gfx_latency, "Display, bus, cache miss and draw latencies",
+              cmd_gfx_latency),
+#endif
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(gfx, &sub_gfx, "SSD1306 graphics", NULL);
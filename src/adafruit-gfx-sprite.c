@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-damage.h"
+#include "adafruit-gfx-sprite.h"
+#include "adafruit-gfx-utils.h"
+
+static struct adafruit_gfx_sprite_t *sprites;   /* bottom first */
+static struct adafruit_gfx_sprite_t *top;
+static struct adafruit_gfx_damage_t dirty[CONFIG_ADAFRUIT_SSD1306_SPRITE_DIRTY_RECTS];
+static int dirty_count;
+
+void adafruit_gfx_sprite_init(struct adafruit_gfx_sprite_t *sprite, int mode, const uint8_t *bits,
+        const uint8_t *mask, int w, int h, uint8_t *buf, size_t len)
+{
+    memset(sprite, 0, sizeof(*sprite));
+    sprite->mode = mode;
+    sprite->bits = bits;
+    sprite->mask = mask;
+    sprite->w = w;
+    sprite->h = h;
+    sprite->buf = buf;
+    sprite->len = len;
+    sprite->visible = true;
+}
+
+/* Add a sprite on top of the others, shown from the next commit */
+void adafruit_gfx_sprite_add(struct adafruit_gfx_sprite_t *sprite)
+{
+    if (sprite->added) {
+        sprite->removed = false;
+        sprite->changed = true;
+        return;
+    }
+
+    sprite->next = NULL;
+    sprite->prev = top;
+    if (top) {
+        top->next = sprite;
+    } else {
+        sprites = sprite;
+    }
+    top = sprite;
+    sprite->added = true;
+    sprite->removed = false;
+    sprite->changed = true;
+}
+
+static void _unlink(struct adafruit_gfx_sprite_t *sprite)
+{
+    if (sprite->prev) {
+        sprite->prev->next = sprite->next;
+    } else {
+        sprites = sprite->next;
+    }
+    if (sprite->next) {
+        sprite->next->prev = sprite->prev;
+    } else {
+        top = sprite->prev;
+    }
+    sprite->next = NULL;
+    sprite->prev = NULL;
+    sprite->added = false;
+}
+
+/* A sprite on screen is taken off by the next commit */
+void adafruit_gfx_sprite_remove(struct adafruit_gfx_sprite_t *sprite)
+{
+    if (!sprite->added) {
+        return;
+    }
+
+    if (sprite->drawn) {
+        sprite->removed = true;
+        sprite->changed = true;
+    } else {
+        _unlink(sprite);
+    }
+}
+
+void adafruit_gfx_sprite_set_pos(struct adafruit_gfx_sprite_t *sprite, int x, int y)
+{
+    if (sprite->x != x || sprite->y != y) {
+        sprite->x = x;
+        sprite->y = y;
+        sprite->changed = true;
+    }
+}
+
+void adafruit_gfx_sprite_set_visible(struct adafruit_gfx_sprite_t *sprite, bool visible)
+{
+    if (sprite->visible != visible) {
+        sprite->visible = visible;
+        sprite->changed = true;
+    }
+}
+
+/* The new image must be the same size */
+void adafruit_gfx_sprite_set_image(struct adafruit_gfx_sprite_t *sprite, const uint8_t *bits,
+        const uint8_t *mask)
+{
+    sprite->bits = bits;
+    sprite->mask = mask;
+    sprite->changed = true;
+}
+
+/* Take a sprite off the draw buffer, leaving what was below it */
+static int _sprite_erase(struct adafruit_gfx_sprite_t *sprite)
+{
+    int ret;
+
+    if (!sprite->drawn) {
+        return 0;
+    }
+    sprite->drawn = false;
+
+    if (sprite->mode == GFX_SPRITE_XOR) {
+        return adafruit_gfx_drawPages(sprite->dx, sprite->dy, sprite->w, sprite->h,
+                                      sprite->dbits, NULL);
+    }
+
+    ret = adafruit_gfx_restoreRegionRect(&sprite->save, sprite->dx, sprite->dy,
+                                         sprite->w, sprite->h);
+    adafruit_gfx_releaseRegion(&sprite->save);
+    return ret;
+}
+
+static int _sprite_draw(struct adafruit_gfx_sprite_t *sprite)
+{
+    int ret;
+
+    if (!sprite->visible || sprite->removed ||
+        adafruit_gfx_regionSize(sprite->x, sprite->y, sprite->w, sprite->h) == 0) {
+        return 0;
+    }
+
+    if (sprite->mode == GFX_SPRITE_XOR) {
+        ret = adafruit_gfx_drawPages(sprite->x, sprite->y, sprite->w, sprite->h,
+                                     sprite->bits, NULL);
+    } else {
+        ret = adafruit_gfx_saveRegion(&sprite->save, sprite->x, sprite->y, sprite->w, sprite->h,
+                                      sprite->buf, sprite->len);
+        if (ret != 0) {
+            return ret;
+        }
+        ret = adafruit_gfx_drawPages(sprite->x, sprite->y, sprite->w, sprite->h,
+                                     sprite->bits, sprite->mask);
+    }
+
+    sprite->drawn = true;
+    sprite->dx = sprite->x;
+    sprite->dy = sprite->y;
+    sprite->dbits = sprite->bits;
+    return ret;
+}
+
+/* The rectangles a commit touches for a sprite: as drawn, and as it goes */
+static int _sprite_rects(const struct adafruit_gfx_sprite_t *sprite,
+        struct adafruit_gfx_damage_t *r)
+{
+    int n = 0;
+
+    if (sprite->drawn) {
+        r[n++] = (struct adafruit_gfx_damage_t){ sprite->dx, sprite->dy, sprite->w, sprite->h };
+    }
+    if (sprite->visible && !sprite->removed) {
+        r[n++] = (struct adafruit_gfx_damage_t){ sprite->x, sprite->y, sprite->w, sprite->h };
+    }
+    return n;
+}
+
+/* True if a sprite touches the rectangles of an affected sprite below it */
+static bool _sprite_disturbed(const struct adafruit_gfx_sprite_t *sprite)
+{
+    struct adafruit_gfx_damage_t r[2];
+    struct adafruit_gfx_damage_t b[2];
+    int n = _sprite_rects(sprite, r);
+
+    for (const struct adafruit_gfx_sprite_t *below = sprite->prev; below; below = below->prev) {
+        if (!below->redraw) {
+            continue;
+        }
+
+        int nb = _sprite_rects(below, b);
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < nb; j++) {
+                if (r[i].x < b[j].x + b[j].w && b[j].x < r[i].x + r[i].w &&
+                    r[i].y < b[j].y + b[j].h && b[j].y < r[i].y + r[i].h) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Move the sprites to their new state and send what changed to the panel:
+ * the old and new rectangles of every changed sprite, merged.  Only the
+ * changed sprites are taken off the draw buffer and put back, along with
+ * the sprites above them that overlap them before or after (taking off or
+ * drawing the lower one would disturb those).  The rest stay as they are.
+ * Does nothing at all if no sprite changed.  A sprite that fails to draw
+ * stays changed, and rectangles that fail to go out are kept, so the next
+ * commit tries again.  The clip is ignored and left as it was.
+ */
+int adafruit_gfx_sprites_commit(void)
+{
+    struct adafruit_gfx_sprite_t *sprite, *next;
+    struct adafruit_gfx_damage_t r[2];
+    int cx, cy, cw, ch;
+    int sent = 0;
+    int ret = 0;
+    bool redraw = false;
+
+    /* Bottom first, so the affected sprites below are known */
+    for (sprite = sprites; sprite; sprite = sprite->next) {
+        sprite->redraw = sprite->changed || _sprite_disturbed(sprite);
+        redraw |= sprite->redraw;
+
+        if (sprite->changed) {
+            int n = _sprite_rects(sprite, r);
+
+            for (int i = 0; i < n; i++) {
+                dirty_count = adafruit_gfx_damage_add(dirty, dirty_count, ARRAY_SIZE(dirty),
+                                                      r[i].x, r[i].y, r[i].w, r[i].h);
+            }
+        }
+    }
+
+    if (!redraw && dirty_count == 0) {
+        return 0;
+    }
+
+    if (redraw) {
+        adafruit_gfx_getClipRect(&cx, &cy, &cw, &ch);
+        adafruit_gfx_resetClip();
+
+        /* Top first, so each sprite puts back what the ones below it drew */
+        for (sprite = top; sprite; sprite = sprite->prev) {
+            if (sprite->redraw) {
+                int err = _sprite_erase(sprite);
+                ret = ret ? ret : err;
+            }
+        }
+
+        for (sprite = sprites; sprite; sprite = next) {
+            next = sprite->next;
+            if (!sprite->redraw) {
+                continue;
+            }
+            if (sprite->removed) {
+                sprite->removed = false;
+                sprite->changed = false;
+                _unlink(sprite);
+                continue;
+            }
+
+            int err = _sprite_draw(sprite);
+            sprite->changed = (err != 0);
+            ret = ret ? ret : err;
+        }
+
+        adafruit_gfx_setClipRect(cx, cy, cw, ch);
+    }
+
+    if (ret != 0) {
+        return ret;
+    }
+
+    for (; sent < dirty_count; sent++) {
+        ret = adafruit_gfx_displayRegion(dirty[sent].x, dirty[sent].y, dirty[sent].w, dirty[sent].h);
+        if (ret != 0) {
+            break;
+        }
+    }
+    dirty_count = adafruit_gfx_damage_drop(dirty, dirty_count, sent);
+
+    return ret;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-cache.h"
+#include "ssd1306_emul.h"
+
+#define FRAME_SIZE  (SSD1306_EMUL_WIDTH * SSD1306_EMUL_PAGES)
+
+extern const uint8_t adafruit_logo[];
+
+static uint8_t expected[FRAME_SIZE];
+
+static void _expect_rect(int x, int y, int w, int h)
+{
+    for (int i = x; i < x + w; i++) {
+        for (int j = y; j < y + h; j++) {
+            expected[i + (j >> 3) * SSD1306_EMUL_WIDTH] |= BIT(j & 7);
+        }
+    }
+}
+
+static void test_initialize(void)
+{
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+
+    /* The first frame is the logo, copied into the mapped RAM by init */
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+    zassert_mem_equal(ssd1306_emul_gddram(), adafruit_logo, FRAME_SIZE, "logo differs");
+}
+
+static void test_mapping_is_host_memory(void)
+{
+    uint8_t *ram = adafruit_gfx_cache_mapping(NULL);
+
+    zassert_not_null(ram, "no host buffer behind the mapping");
+
+    adafruit_gfx_clearDisplay();
+    adafruit_gfx_drawPixel(3, 9, WHITE);
+    zassert_equal(ram[3 + SSD1306_EMUL_WIDTH], BIT(1), "pixel not drawn in place");
+}
+
+static void test_display_sends_mapped_bytes(void)
+{
+    const uint8_t *ram = adafruit_gfx_cache_mapping(NULL);
+
+    memset(expected, 0, sizeof(expected));
+    adafruit_gfx_clearDisplay();
+
+    adafruit_gfx_fillRect(10, 5, 20, 12, WHITE);
+    _expect_rect(10, 5, 20, 12);
+    adafruit_gfx_drawFastVLine(127, 0, 64, WHITE);
+    _expect_rect(127, 0, 1, 64);
+    adafruit_gfx_drawPixel(0, 63, WHITE);
+    _expect_rect(0, 63, 1, 1);
+
+    ssd1306_emul_clear();
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+    zassert_mem_equal(ram, expected, FRAME_SIZE, "draw buffer differs");
+    zassert_mem_equal(ssd1306_emul_gddram(), expected, FRAME_SIZE, "panel differs");
+}
+
+static void test_display_region_sends_window(void)
+{
+    adafruit_gfx_clearDisplay();
+    adafruit_gfx_fillRect(40, 20, 8, 8, WHITE);
+
+    ssd1306_emul_clear();
+    zassert_equal(adafruit_gfx_displayRegion(40, 20, 8, 8), 0, "displayRegion failed");
+
+    /* Pages 2 and 3 of columns 40-47 are sent, nothing else */
+    memset(expected, 0, sizeof(expected));
+    _expect_rect(40, 20, 8, 8);
+    zassert_mem_equal(ssd1306_emul_gddram(), expected, FRAME_SIZE, "panel differs");
+}
+
+void test_main(void)
+{
+    ztest_test_suite(cache_mapped,
+                     ztest_unit_test(test_initialize),
+                     ztest_unit_test(test_mapping_is_host_memory),
+                     ztest_unit_test(test_display_sends_mapped_bytes),
+                     ztest_unit_test(test_display_region_sends_window));
+    ztest_run_test_suite(cache_mapped);
+}
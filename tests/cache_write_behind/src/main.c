@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "ssd1306_emul.h"
+#include "test_util.h"
+
+/*
+ * One small cache line and two write buffers, so nearly every access
+ * evicts a line whose write is still queued.  INVERSE drawing reads every
+ * byte it changes: a read that missed a queued write would show up as a
+ * wrong pixel on the panel.
+ */
+#define PANEL_W     SSD1306_EMUL_WIDTH
+#define PANEL_H     (SSD1306_EMUL_PAGES * 8)
+#define FRAME_SIZE  (SSD1306_EMUL_WIDTH * SSD1306_EMUL_PAGES)
+
+extern const uint8_t adafruit_logo[];
+
+static void _fill_inverse(int x, int y, int w, int h)
+{
+    adafruit_gfx_fillRect(x, y, w, h, INVERSE);
+    panel_model_rect(x, y, w, h, INVERSE);
+}
+
+static void _random_rect(int *x, int *y, int *w, int *h)
+{
+    *x = test_rand() % PANEL_W;
+    *y = test_rand() % PANEL_H;
+    *w = test_rand() % 48 + 1;
+    *h = test_rand() % 24 + 1;
+    *w = MIN(*w, PANEL_W - *x);
+    *h = MIN(*h, PANEL_H - *y);
+}
+
+static void _check_panel(void)
+{
+    int bad = panel_model_diff();
+
+    zassert_equal(bad, 0, "%d pixels differ", bad);
+}
+
+static void test_initialize(void)
+{
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+
+    /* The logo was preloaded through the write buffers */
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+    zassert_mem_equal(ssd1306_emul_gddram(), adafruit_logo, FRAME_SIZE, "logo differs");
+}
+
+static void test_read_after_queued_write(void)
+{
+    struct adafruit_gfx_cache_stats_t stats;
+
+    adafruit_gfx_clearDisplay();
+    panel_model_reset();
+    adafruit_gfx_cache_stats(NULL, true);
+
+    for (int i = 0; i < 200; i++) {
+        int x, y, w, h;
+
+        _random_rect(&x, &y, &w, &h);
+        _fill_inverse(x, y, w, h);
+    }
+
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+    _check_panel();
+
+    adafruit_gfx_cache_stats(&stats, false);
+    zassert_true(stats.writebacks > 0, "no line was written behind");
+    zassert_true(stats.misses > 0, "no line was read back");
+}
+
+static void test_interleaved_flushes(void)
+{
+    for (int i = 0; i < 50; i++) {
+        int x, y, w, h;
+
+        _random_rect(&x, &y, &w, &h);
+        _fill_inverse(x, y, w, h);
+        zassert_equal(adafruit_gfx_displayRegion(x, y, w, h), 0, "displayRegion failed");
+    }
+    _check_panel();
+}
+
+void test_main(void)
+{
+    ztest_test_suite(cache_write_behind,
+                     ztest_unit_test(test_initialize),
+                     ztest_unit_test(test_read_after_queued_write),
+                     ztest_unit_test(test_interleaved_flushes));
+    ztest_run_test_suite(cache_write_behind);
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <stdlib.h>
+
+#include "adafruit-gfx-api.h"
+#include "ssd1306_emul.h"
+#include "test_util.h"
+
+/*
+ * drawLine() clips a line before it walks it, and must still light exactly
+ * the pixels the unclipped walk would.  Random lines, many of them with
+ * endpoints far off the screen, are drawn with INVERSE at every rotation
+ * and checked against a plain Bresenham walk over every step into the
+ * screen model, with and without a clip rectangle.
+ */
+static int clip_x0, clip_y0, clip_x1, clip_y1;
+
+static void _model_pixel(int x, int y)
+{
+    if (x >= clip_x0 && x < clip_x1 && y >= clip_y0 && y < clip_y1) {
+        panel_model_pixel(x, y, INVERSE);
+    }
+}
+
+static void _model_line(int x0, int y0, int x1, int y1)
+{
+    bool steep = abs(y1 - y0) > abs(x1 - x0);
+    int t;
+
+    if (steep) {
+        t = x0; x0 = y0; y0 = t;
+        t = x1; x1 = y1; y1 = t;
+    }
+    if (x0 > x1) {
+        t = x0; x0 = x1; x1 = t;
+        t = y0; y0 = y1; y1 = t;
+    }
+
+    int dx = x1 - x0;
+    int dy = abs(y1 - y0);
+    int err = dx / 2;
+    int ystep = (y0 < y1) ? 1 : -1;
+
+    for (; x0 <= x1; x0++) {
+        if (steep) {
+            _model_pixel(y0, x0);
+        } else {
+            _model_pixel(x0, y0);
+        }
+        err -= dy;
+        if (err < 0) {
+            y0 += ystep;
+            err += dx;
+        }
+    }
+}
+
+static int _coord(int span, int size)
+{
+    return (int)(test_rand() % span) - span / 2 + size / 2;
+}
+
+static void _screens(int count, bool clipped)
+{
+    /* How far from the middle of the screen the endpoints may land */
+    static const int spans[] = { 4000, 300, 150 };
+
+    for (int n = 0; n < count; n++) {
+        int r = n % 4;
+
+        adafruit_gfx_setRotation(r);
+        int width = adafruit_gfx_width();
+        int height = adafruit_gfx_height();
+
+        panel_model_reset();
+        adafruit_gfx_clearDisplay();
+        if (clipped) {
+            int w;
+            int h;
+
+            adafruit_gfx_setClipRect(test_rand() % width, test_rand() % height,
+                                     test_rand() % width + 1, test_rand() % height + 1);
+            adafruit_gfx_getClipRect(&clip_x0, &clip_y0, &w, &h);
+            clip_x1 = clip_x0 + w;
+            clip_y1 = clip_y0 + h;
+        } else {
+            clip_x0 = clip_y0 = 0;
+            clip_x1 = width;
+            clip_y1 = height;
+        }
+
+        for (int i = 0; i < 6; i++) {
+            int span = spans[i % ARRAY_SIZE(spans)];
+            int x0 = _coord(span, width);
+            int y0 = _coord(span, height);
+            int x1 = _coord(span, width);
+            int y1 = _coord(span, height);
+
+            /* Single pixels and two pixel stubs */
+            if (i == 5) {
+                x1 = x0 + (int)(test_rand() % 3) - 1;
+                y1 = y0 + (int)(test_rand() % 3) - 1;
+            }
+
+            adafruit_gfx_drawLine(x0, y0, x1, y1, INVERSE);
+            _model_line(x0, y0, x1, y1);
+        }
+
+        zassert_equal(adafruit_gfx_display(), 0, "display failed");
+
+        int bad = panel_model_diff();
+        zassert_equal(bad, 0, "screen %d, rotation %d: %d pixels differ", n, r, bad);
+    }
+
+    adafruit_gfx_setRotation(0);
+}
+
+static void test_initialize(void)
+{
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+}
+
+static void test_unclipped(void)
+{
+    _screens(200, false);
+}
+
+static void test_clipped(void)
+{
+    _screens(400, true);
+}
+
+/* Lines through a one pixel clip, and along each edge of the clip */
+static void test_edges(void)
+{
+    for (int r = 0; r < 4; r++) {
+        adafruit_gfx_setRotation(r);
+        panel_model_reset();
+        adafruit_gfx_clearDisplay();
+
+        clip_x0 = 20;
+        clip_y0 = 10;
+        clip_x1 = 41;
+        clip_y1 = 31;
+        adafruit_gfx_setClipRect(clip_x0, clip_y0, clip_x1 - clip_x0, clip_y1 - clip_y0);
+
+        static const int lines[][4] = {
+            { -1000, 10, 1000, 10 },        /* along the top edge */
+            { 40, -1000, 40, 1000 },        /* along the right edge */
+            { 19, 9, 41, 31 },              /* corner to corner, just outside */
+            { -500, 1000, 1000, -500 },     /* crossing steeply from far away */
+            { 0, 30, 60, 30 },              /* along the bottom edge */
+            { 20, -3000, 21, 3000 },        /* almost vertical */
+        };
+
+        for (int i = 0; i < ARRAY_SIZE(lines); i++) {
+            adafruit_gfx_drawLine(lines[i][0], lines[i][1], lines[i][2], lines[i][3], INVERSE);
+            _model_line(lines[i][0], lines[i][1], lines[i][2], lines[i][3]);
+        }
+
+        zassert_equal(adafruit_gfx_display(), 0, "display failed");
+
+        int bad = panel_model_diff();
+        zassert_equal(bad, 0, "rotation %d: %d pixels differ", r, bad);
+        adafruit_gfx_resetClip();
+    }
+
+    adafruit_gfx_setRotation(0);
+}
+
+void test_main(void)
+{
+    ztest_test_suite(clip_line,
+                     ztest_unit_test(test_initialize),
+                     ztest_unit_test(test_unclipped),
+                     ztest_unit_test(test_clipped),
+                     ztest_unit_test(test_edges));
+    ztest_run_test_suite(clip_line);
+}
@@ -0,0 +1,17 @@
+# Copyright (c) 2020 Gavin Hurlbut
+# SPDX-License-Identifier: Apache-2.0
+
+# Shared by the test applications: the module under test, the common Kconfig,
+# the panel on the emulated I2C bus and the shared test helpers.  Include
+# before find_package(Zephyr).
+
+get_filename_component(ADAFRUIT_SSD1306_ROOT ${CMAKE_CURRENT_LIST_DIR}/../.. ABSOLUTE)
+set(ADAFRUIT_SSD1306_TEST_COMMON ${CMAKE_CURRENT_LIST_DIR})
+set(ADAFRUIT_SSD1306_TEST_SOURCES
+    ${ADAFRUIT_SSD1306_TEST_COMMON}/ssd1306_emul.c
+    ${ADAFRUIT_SSD1306_TEST_COMMON}/test_util.c
+)
+
+list(APPEND ZEPHYR_EXTRA_MODULES ${ADAFRUIT_SSD1306_ROOT})
+set(DTC_OVERLAY_FILE ${ADAFRUIT_SSD1306_TEST_COMMON}/native_posix.overlay)
+list(APPEND OVERLAY_CONFIG ${ADAFRUIT_SSD1306_TEST_COMMON}/common.conf)
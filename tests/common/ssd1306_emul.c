@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT solomon_ssd1306fb
+
+#include <zephyr.h>
+#include <device.h>
+#include <string.h>
+#include <drivers/emul.h>
+#include <drivers/i2c.h>
+#include <drivers/i2c_emul.h>
+
+#include "ssd1306_emul.h"
+
+#define SSD1306_CONTROL_CO      0x80    /* one byte follows, then a new control */
+#define SSD1306_CONTROL_DATA    0x40
+
+#define SSD1306_ADDR_HORIZONTAL 0
+#define SSD1306_ADDR_PAGE       2
+
+struct ssd1306_emul_data {
+    struct i2c_emul emul;
+    uint8_t gddram[SSD1306_EMUL_PAGES * SSD1306_EMUL_WIDTH];
+    /* Control byte decoding */
+    bool want_control;
+    bool single;
+    bool data;
+    /* Command being assembled */
+    uint8_t cmd[7];
+    uint8_t cmd_len;
+    uint8_t cmd_need;
+    /* Addressing */
+    uint8_t mode;
+    uint8_t col;
+    uint8_t col_start;
+    uint8_t col_end;
+    uint8_t page;
+    uint8_t page_start;
+    uint8_t page_end;
+    uint8_t start_line;
+};
+
+struct ssd1306_emul_cfg {
+    struct ssd1306_emul_data *data;
+    uint16_t addr;
+};
+
+static struct ssd1306_emul_data emul_data;
+
+/* Bytes in each command, the opcode included */
+static uint8_t _cmd_length(uint8_t op)
+{
+    switch (op) {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        return 2;
+    case 0x21: case 0x22: case 0xA3:
+        return 3;
+    case 0x29: case 0x2A:
+        return 6;
+    case 0x26: case 0x27:
+        return 7;
+    default:
+        return 1;
+    }
+}
+
+static void _command(struct ssd1306_emul_data *data)
+{
+    uint8_t op = data->cmd[0];
+
+    if (op == 0x20) {
+        data->mode = data->cmd[1] & 0x03;
+    } else if (op == 0x21) {
+        data->col_start = data->cmd[1] % SSD1306_EMUL_WIDTH;
+        data->col_end = data->cmd[2] % SSD1306_EMUL_WIDTH;
+        data->col = data->col_start;
+    } else if (op == 0x22) {
+        data->page_start = data->cmd[1] % SSD1306_EMUL_PAGES;
+        data->page_end = data->cmd[2] % SSD1306_EMUL_PAGES;
+        data->page = data->page_start;
+    } else if (op >= 0x40 && op <= 0x7F) {
+        data->start_line = op & 0x3F;
+    } else if (data->mode == SSD1306_ADDR_PAGE) {
+        if (op <= 0x0F) {
+            data->col = (data->col & 0xF0) | op;
+        } else if (op <= 0x1F) {
+            data->col = (data->col & 0x0F) | ((op & 0x0F) << 4);
+        } else if (op >= 0xB0 && op <= 0xB7) {
+            data->page = op & 0x07;
+        }
+    }
+}
+
+static void _data(struct ssd1306_emul_data *data, uint8_t byte)
+{
+    data->gddram[data->col % SSD1306_EMUL_WIDTH + data->page * SSD1306_EMUL_WIDTH] = byte;
+
+    if (data->mode == SSD1306_ADDR_PAGE) {
+        data->col = (data->col + 1) % SSD1306_EMUL_WIDTH;
+        return;
+    }
+
+    if (data->col == data->col_end) {
+        data->col = data->col_start;
+        data->page = (data->page == data->page_end) ? data->page_start : data->page + 1;
+    } else {
+        data->col = (data->col + 1) % SSD1306_EMUL_WIDTH;
+    }
+}
+
+static void _byte(struct ssd1306_emul_data *data, uint8_t byte)
+{
+    if (data->want_control) {
+        data->single = (byte & SSD1306_CONTROL_CO) != 0;
+        data->data = (byte & SSD1306_CONTROL_DATA) != 0;
+        data->want_control = false;
+        return;
+    }
+
+    if (data->data) {
+        _data(data, byte);
+    } else {
+        if (data->cmd_len == 0) {
+            data->cmd_need = _cmd_length(byte);
+        }
+        data->cmd[data->cmd_len++] = byte;
+        if (data->cmd_len == data->cmd_need) {
+            _command(data);
+            data->cmd_len = 0;
+        }
+    }
+
+    data->want_control = data->single;
+}
+
+static int ssd1306_emul_transfer(struct i2c_emul *emul, struct i2c_msg *msgs, int num_msgs,
+        int addr)
+{
+    struct ssd1306_emul_data *data = CONTAINER_OF(emul, struct ssd1306_emul_data, emul);
+
+    /* Every transaction starts with a control byte */
+    data->want_control = true;
+    data->cmd_len = 0;
+
+    for (int i = 0; i < num_msgs; i++) {
+        if (msgs[i].flags & I2C_MSG_READ) {
+            return -EIO;
+        }
+        for (uint32_t j = 0; j < msgs[i].len; j++) {
+            _byte(data, msgs[i].buf[j]);
+        }
+    }
+
+    return 0;
+}
+
+static struct i2c_emul_api ssd1306_emul_api = {
+    .transfer = ssd1306_emul_transfer,
+};
+
+static int ssd1306_emul_init(const struct emul *emul, const struct device *parent)
+{
+    const struct ssd1306_emul_cfg *cfg = emul->cfg;
+    struct ssd1306_emul_data *data = cfg->data;
+
+    data->emul.api = &ssd1306_emul_api;
+    data->emul.addr = cfg->addr;
+    data->col_end = SSD1306_EMUL_WIDTH - 1;
+    data->page_end = SSD1306_EMUL_PAGES - 1;
+    data->mode = SSD1306_ADDR_PAGE;
+
+    return i2c_emul_register(parent, emul->dev_label, &data->emul);
+}
+
+static const struct ssd1306_emul_cfg emul_cfg = {
+    .data = &emul_data,
+    .addr = DT_INST_REG_ADDR(0),
+};
+
+EMUL_DEFINE(ssd1306_emul_init, DT_DRV_INST(0), &emul_cfg);
+
+const uint8_t *ssd1306_emul_gddram(void)
+{
+    return emul_data.gddram;
+}
+
+void ssd1306_emul_clear(void)
+{
+    memset(emul_data.gddram, 0, sizeof(emul_data.gddram));
+}
+
+int ssd1306_emul_start_line(void)
+{
+    return emul_data.start_line;
+}
+
+bool ssd1306_emul_pixel(int x, int y)
+{
+    return (emul_data.gddram[x + (y >> 3) * SSD1306_EMUL_WIDTH] >> (y & 7)) & 1;
+}
+
+bool ssd1306_emul_shown(int x, int y)
+{
+    return ssd1306_emul_pixel(x, (y + emul_data.start_line) % (SSD1306_EMUL_PAGES * 8));
+}
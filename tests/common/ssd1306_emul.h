@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __ssd1306_emul_h_
+#define __ssd1306_emul_h_
+
+#include <zephyr.h>
+
+/*
+ * I2C emulator for the SSD1306 on native_posix.  It decodes the command and
+ * data stream the driver sends and keeps the panel's RAM, one byte per
+ * column per page, laid out like the library's draw buffer.
+ */
+
+#define SSD1306_EMUL_WIDTH      128
+#define SSD1306_EMUL_PAGES      8
+
+const uint8_t *ssd1306_emul_gddram(void);
+void ssd1306_emul_clear(void);
+int ssd1306_emul_start_line(void);
+bool ssd1306_emul_pixel(int x, int y);
+/* Pixel in row y of the panel as shown, after the display start line */
+bool ssd1306_emul_shown(int x, int y);
+
+#endif /* __ssd1306_emul_h_ */
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "ssd1306_emul.h"
+#include "test_util.h"
+
+#define PANEL_W     SSD1306_EMUL_WIDTH
+#define PANEL_H     (SSD1306_EMUL_PAGES * 8)
+
+static uint32_t seed = 1;
+
+static bool model[PANEL_W * PANEL_H];
+static int rotation;
+static int width;
+static int height;
+
+void test_srand(uint32_t s)
+{
+    seed = s ? s : 1;
+}
+
+uint32_t test_rand(void)
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+void panel_model_reset(void)
+{
+    rotation = adafruit_gfx_getRotation();
+    width = adafruit_gfx_width();
+    height = adafruit_gfx_height();
+    memset(model, 0, sizeof(model));
+}
+
+void panel_model_pixel(int x, int y, int color)
+{
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+        return;
+    }
+
+    bool *p = &model[x + y * width];
+    *p = (color == INVERSE) ? !*p : (color == WHITE);
+}
+
+void panel_model_rect(int x, int y, int w, int h, int color)
+{
+    for (int j = y; j < y + h; j++) {
+        for (int i = x; i < x + w; i++) {
+            panel_model_pixel(i, j, color);
+        }
+    }
+}
+
+bool panel_model_get(int x, int y)
+{
+    return model[x + y * width];
+}
+
+int panel_model_diff(void)
+{
+    int bad = 0;
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int px = x;
+            int py = y;
+
+            switch (rotation) {
+            case 1:
+                px = PANEL_W - 1 - y;
+                py = x;
+                break;
+            case 2:
+                px = PANEL_W - 1 - x;
+                py = PANEL_H - 1 - y;
+                break;
+            case 3:
+                px = y;
+                py = PANEL_H - 1 - x;
+                break;
+            }
+            bad += ssd1306_emul_shown(px, py) != model[x + y * width];
+        }
+    }
+
+    return bad;
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef __test_util_h_
+#define __test_util_h_
+
+#include <zephyr.h>
+
+/*
+ * Helpers shared by the test applications: a small repeatable random
+ * number generator, and a model of the logical screen to check the
+ * emulated panel against.
+ */
+
+/* xorshift32, seeded with 1 unless test_srand() says otherwise */
+void test_srand(uint32_t seed);
+uint32_t test_rand(void);
+
+/*
+ * The model covers the screen at the rotation that was current when it
+ * was reset.  Colors are WHITE, BLACK and INVERSE, as for drawing.
+ */
+void panel_model_reset(void);
+void panel_model_rect(int x, int y, int w, int h, int color);
+void panel_model_pixel(int x, int y, int color);
+bool panel_model_get(int x, int y);
+
+/* Number of pixels the panel shows differently from the model */
+int panel_model_diff(void);
+
+#endif /* __test_util_h_ */
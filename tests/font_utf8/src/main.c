@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-font.h"
+#include "ssd1306_emul.h"
+
+/*
+ * Every glyph is a single pixel.  Glyph i advances the cursor by i + 1 and
+ * draws its pixel i + 1 rows above the baseline, so both the cursor and the
+ * panel tell which glyph a code point found.
+ */
+#define GLYPH(i)    { .bitmapOffset = 0, .width = 1, .height = 1, .xAdvance = (i) + 1, \
+                      .xOffset = 0, .yOffset = -1 - (i) }
+
+static uint8_t bitmap[] = { 0x80 };
+
+static GFXglyph glyphs[] = {
+    GLYPH(0), GLYPH(1), GLYPH(2),   /* A B C */
+    GLYPH(3),                       /* U+00E9 */
+    GLYPH(4),                       /* U+20AC */
+    GLYPH(5), GLYPH(6),             /* U+1F600 U+1F601 */
+    GLYPH(7),                       /* U+FFFD */
+};
+
+static const GFXrange ranges[] = {
+    { .first = 'A', .length = 3, .glyphIndex = 0 },
+    { .first = 0x00E9, .length = 1, .glyphIndex = 3 },
+    { .first = 0x20AC, .length = 1, .glyphIndex = 4 },
+    { .first = 0xFFFD, .length = 1, .glyphIndex = 7 },
+    { .first = 0x1F600, .length = 2, .glyphIndex = 5 },
+};
+
+static const GFXfont font = {
+    .bitmap = bitmap,
+    .glyph = glyphs,
+    .yAdvance = 16,
+    .ranges = ranges,
+    .range_count = ARRAY_SIZE(ranges),
+};
+
+/* Cursor advance of a string printed from x = 0 */
+static int _advance(const char *str)
+{
+    adafruit_gfx_setCursor(0, 40);
+    adafruit_gfx_print(str);
+    return adafruit_gfx_getCursorX();
+}
+
+/* Cursor advance of a string fed to write() a byte at a time */
+static int _advance_bytes(const char *str)
+{
+    adafruit_gfx_setCursor(0, 40);
+    while (*str) {
+        adafruit_gfx_write(*str++);
+    }
+    return adafruit_gfx_getCursorX();
+}
+
+static void test_initialize(void)
+{
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+    adafruit_gfx_clearDisplay();
+    adafruit_gfx_setTextWrap(false);
+    adafruit_gfx_setTextColor(WHITE, WHITE);
+    adafruit_gfx_setFont(&font);
+}
+
+static void test_range_lookup(void)
+{
+    adafruit_gfx_utf8(true);
+
+    zassert_equal(_advance("A"), 1, "A");
+    zassert_equal(_advance("C"), 3, "last of a range");
+    zassert_equal(_advance("\xC3\xA9"), 4, "U+00E9");
+    zassert_equal(_advance("\xE2\x82\xAC"), 5, "U+20AC");
+    zassert_equal(_advance("\xF0\x9F\x98\x80"), 6, "U+1F600");
+    zassert_equal(_advance("\xF0\x9F\x98\x81"), 7, "U+1F601");
+
+    /* Between, before and after the ranges */
+    zassert_equal(_advance("D"), 0, "D is not in the font");
+    zassert_equal(_advance("@"), 0, "@ is not in the font");
+    zassert_equal(_advance("\xF0\x9F\x98\x82"), 0, "U+1F602 is not in the font");
+
+    zassert_equal(_advance("AB\xE2\x82\xAC" "C"), 1 + 2 + 5 + 3, "mixed string");
+}
+
+static void test_malformed(void)
+{
+    adafruit_gfx_utf8(true);
+
+    /* A bad lead byte and a truncated sequence both give U+FFFD */
+    zassert_equal(_advance("\xFF" "A"), 8 + 1, "bad lead byte");
+    zassert_equal(_advance("\xE2\x82" "A"), 8 + 1, "truncated sequence");
+}
+
+static void test_write_bytes(void)
+{
+    adafruit_gfx_utf8(true);
+
+    zassert_equal(_advance_bytes("A\xC3\xA9" "B"), 1 + 4 + 2, "write() decodes UTF-8");
+    zassert_equal(_advance_bytes("\xF0\x9F\x98\x81"), 7, "write() four byte sequence");
+    zassert_equal(_advance_bytes("\x82" "A"), 1, "stray continuation byte");
+
+    /* Without UTF-8 every byte is a code point of its own */
+    adafruit_gfx_utf8(false);
+    zassert_equal(_advance_bytes("\xC3\xA9"), 0, "raw bytes are not in the font");
+    zassert_equal(_advance("AB"), 3, "raw ASCII");
+}
+
+static void test_text_bounds(void)
+{
+    int x1, y1, w, h;
+
+    adafruit_gfx_utf8(true);
+    adafruit_gfx_getTextBounds("A\xE2\x82\xAC", 0, 40, 1, &x1, &y1, &w, &h);
+
+    /* The pixels of glyphs 0 and 4, one and five rows above the baseline */
+    zassert_equal(x1, 0, "x1");
+    zassert_equal(y1, 40 - 5, "y1");
+    zassert_equal(w, 2, "w");
+    zassert_equal(h, 5, "h");
+}
+
+static void test_drawn_glyphs(void)
+{
+    adafruit_gfx_utf8(true);
+    adafruit_gfx_clearDisplay();
+    adafruit_gfx_setCursor(10, 40);
+    adafruit_gfx_print("B\xF0\x9F\x98\x80");
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+
+    zassert_true(ssd1306_emul_pixel(10, 40 - 2), "B not drawn");
+    zassert_true(ssd1306_emul_pixel(12, 40 - 6), "U+1F600 not drawn");
+
+    int lit = 0;
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 128; x++) {
+            lit += ssd1306_emul_pixel(x, y);
+        }
+    }
+    zassert_equal(lit, 2, "stray pixels");
+}
+
+static void test_carriage_return(void)
+{
+    int x1, y1, w, h;
+    int cx1, cy1, cw, ch;
+
+    /* The built-in font has a glyph for every byte, 0x0D included */
+    adafruit_gfx_setFont(NULL);
+    adafruit_gfx_setTextSize(1);
+
+    zassert_equal(adafruit_gfx_drawString(0, 0, "A\r\nB\r", GFX_STRING_MEASURE,
+                                          &cx1, &cy1, &cw, &ch), 2, "CR laid out");
+    adafruit_gfx_drawString(0, 0, "A\nB", GFX_STRING_MEASURE, &x1, &y1, &w, &h);
+    zassert_equal(cx1, x1, "x1");
+    zassert_equal(cy1, y1, "y1");
+    zassert_equal(cw, w, "w");
+    zassert_equal(ch, h, "h");
+
+    /* print() lays it out the same way */
+    adafruit_gfx_drawString(0, 0, "A\rB", GFX_STRING_MEASURE, NULL, NULL, &w, NULL);
+    adafruit_gfx_setCursor(0, 0);
+    adafruit_gfx_print("A\rB");
+    zassert_equal(adafruit_gfx_getCursorX(), w, "print() and drawString() differ");
+
+    adafruit_gfx_setFont(&font);
+}
+
+void test_main(void)
+{
+    ztest_test_suite(font_utf8,
+                     ztest_unit_test(test_initialize),
+                     ztest_unit_test(test_range_lookup),
+                     ztest_unit_test(test_malformed),
+                     ztest_unit_test(test_write_bytes),
+                     ztest_unit_test(test_text_bounds),
+                     ztest_unit_test(test_drawn_glyphs),
+                     ztest_unit_test(test_carriage_return));
+    ztest_run_test_suite(font_utf8);
+}
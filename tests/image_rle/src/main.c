@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-image.h"
+#include "ssd1306_emul.h"
+#include "test_util.h"
+
+#define RAW_SIZE    640
+
+static uint8_t raw[RAW_SIZE];
+static uint8_t packed[RAW_SIZE * 2];
+static uint8_t out[RAW_SIZE];
+
+/* Reference encoder, the same format gfx-image-encode.py writes */
+static size_t _encode(const uint8_t *in, size_t len, uint8_t *dst)
+{
+    size_t i = 0;
+    size_t o = 0;
+
+    while (i < len) {
+        size_t run = 1;
+
+        while (i + run < len && in[i + run] == in[i] && run < GFX_IMAGE_RUN_MAX) {
+            run++;
+        }
+        if (run >= GFX_IMAGE_RUN_MIN) {
+            dst[o++] = 0x80 + run - GFX_IMAGE_RUN_MIN;
+            dst[o++] = in[i];
+            i += run;
+            continue;
+        }
+
+        size_t lit = 1;
+        while (i + lit < len && lit < GFX_IMAGE_LITERAL_MAX &&
+               !(i + lit + 1 < len && in[i + lit] == in[i + lit + 1])) {
+            lit++;
+        }
+        dst[o++] = lit - 1;
+        memcpy(&dst[o], &in[i], lit);
+        o += lit;
+        i += lit;
+    }
+
+    return o;
+}
+
+/* Runs (one longer than a token holds) mixed with noise */
+static void _make_raw(void)
+{
+    size_t i = 0;
+
+    while (i < RAW_SIZE) {
+        size_t n = (i == 64) ? 300 : test_rand() % 40 + 1;
+
+        n = MIN(n, RAW_SIZE - i);
+        if (test_rand() & 1) {
+            memset(&raw[i], test_rand(), n);
+        } else {
+            for (size_t j = 0; j < n; j++) {
+                raw[i + j] = test_rand();
+            }
+        }
+        i += n;
+    }
+}
+
+static void test_decode_tokens(void)
+{
+    static const uint8_t stream[] = {
+        0x81, 0xAA,             /* run of 3 */
+        0x02, 0x11, 0x22, 0x33, /* literal of 3 */
+        0xFF, 0x00,             /* run of 129 */
+        0x00, 0x44,             /* literal of 1 */
+    };
+    static const GFXimage img = { .data = stream, .size = sizeof(stream) };
+    struct adafruit_gfx_image_decoder_t dec;
+    uint8_t expected[3 + 3 + 129 + 1];
+
+    memset(expected, 0xAA, 3);
+    expected[3] = 0x11;
+    expected[4] = 0x22;
+    expected[5] = 0x33;
+    memset(&expected[6], 0x00, 129);
+    expected[135] = 0x44;
+
+    adafruit_gfx_image_decoder_init(&dec, &img);
+    zassert_equal(adafruit_gfx_image_decode(&dec, out, sizeof(out)), sizeof(expected),
+                  "wrong decoded length");
+    zassert_mem_equal(out, expected, sizeof(expected), "wrong decoded bytes");
+    zassert_equal(adafruit_gfx_image_decode(&dec, out, 1), 0, "decoded past the end");
+}
+
+static void test_decode_chunked(void)
+{
+    _make_raw();
+    GFXimage img = { .data = packed, .size = _encode(raw, RAW_SIZE, packed) };
+
+    for (size_t chunk = 1; chunk <= 17; chunk++) {
+        struct adafruit_gfx_image_decoder_t dec;
+        size_t done = 0;
+
+        memset(out, 0, sizeof(out));
+        adafruit_gfx_image_decoder_init(&dec, &img);
+        while (done < RAW_SIZE) {
+            size_t n = adafruit_gfx_image_decode(&dec, &out[done], MIN(chunk, RAW_SIZE - done));
+
+            zassert_true(n > 0, "stream ended early");
+            done += n;
+        }
+        zassert_mem_equal(out, raw, RAW_SIZE, "chunked decode differs");
+    }
+}
+
+static void test_skip(void)
+{
+    _make_raw();
+    GFXimage img = { .data = packed, .size = _encode(raw, RAW_SIZE, packed) };
+
+    for (size_t skip = 0; skip < RAW_SIZE; skip += 37) {
+        struct adafruit_gfx_image_decoder_t dec;
+
+        adafruit_gfx_image_decoder_init(&dec, &img);
+        zassert_equal(adafruit_gfx_image_skip(&dec, skip), skip, "short skip");
+        zassert_equal(adafruit_gfx_image_decode(&dec, out, RAW_SIZE - skip), RAW_SIZE - skip,
+                      "short decode after skip");
+        zassert_mem_equal(out, &raw[skip], RAW_SIZE - skip, "decode after skip differs");
+    }
+}
+
+static void test_truncated(void)
+{
+    static const uint8_t no_run_byte[] = { 0x01, 0x11, 0x22, 0x85 };
+    static const uint8_t short_literal[] = { 0x04, 0x11, 0x22 };
+    const GFXimage a = { .data = no_run_byte, .size = sizeof(no_run_byte) };
+    const GFXimage b = { .data = short_literal, .size = sizeof(short_literal) };
+    struct adafruit_gfx_image_decoder_t dec;
+
+    adafruit_gfx_image_decoder_init(&dec, &a);
+    zassert_equal(adafruit_gfx_image_decode(&dec, out, sizeof(out)), 2,
+                  "run without a data byte decoded");
+
+    adafruit_gfx_image_decoder_init(&dec, &b);
+    zassert_equal(adafruit_gfx_image_decode(&dec, out, sizeof(out)), 2,
+                  "read past the end of a literal");
+}
+
+static void test_draw_image(void)
+{
+    const int w = 40;
+    const int pages = 3;
+    const int x0 = 3;
+    const int y0 = 5;
+
+    _make_raw();
+    GFXimage img = {
+        .data = packed, .size = _encode(raw, w * pages, packed),
+        .width = w, .pages = pages,
+    };
+
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+    adafruit_gfx_clearDisplay();
+    zassert_equal(adafruit_gfx_drawImage(x0, y0, &img), 0, "drawImage failed");
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 128; x++) {
+            int sx = x - x0;
+            int sy = y - y0;
+            bool set = false;
+
+            if (sx >= 0 && sx < w && sy >= 0 && sy < pages * 8) {
+                set = (raw[sx + (sy >> 3) * w] >> (sy & 7)) & 1;
+            }
+            zassert_equal(ssd1306_emul_pixel(x, y), set, "pixel %d,%d", x, y);
+        }
+    }
+}
+
+void test_main(void)
+{
+    ztest_test_suite(image_rle,
+                     ztest_unit_test(test_decode_tokens),
+                     ztest_unit_test(test_decode_chunked),
+                     ztest_unit_test(test_skip),
+                     ztest_unit_test(test_truncated),
+                     ztest_unit_test(test_draw_image));
+    ztest_run_test_suite(image_rle);
+}
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-rop.h"
+#include "test_util.h"
+
+/*
+ * Each kernel is run at every alignment of the destination and source, for
+ * lengths around the word size, and checked byte for byte (the bytes around
+ * the range included) against the plain loop it replaces.
+ */
+#define MAX_LEN     48
+#define BUF_SIZE    (MAX_LEN + 16)
+
+static uint8_t dst[BUF_SIZE] __aligned(8);
+static uint8_t src[BUF_SIZE] __aligned(8);
+static uint8_t ref[BUF_SIZE];
+
+static const rop_t rops[] = { ROP_COPY, ROP_OR, ROP_AND, ROP_XOR, ROP_ANDNOT };
+
+static void _fill(void)
+{
+    for (int i = 0; i < BUF_SIZE; i++) {
+        dst[i] = test_rand();
+        src[i] = test_rand();
+    }
+    memcpy(ref, dst, BUF_SIZE);
+}
+
+static uint8_t _rop(uint8_t d, uint8_t s, rop_t rop)
+{
+    switch (rop) {
+    case ROP_COPY:
+        return s;
+    case ROP_OR:
+        return d | s;
+    case ROP_AND:
+        return d & s;
+    case ROP_XOR:
+        return d ^ s;
+    case ROP_ANDNOT:
+        return d & ~s;
+    }
+    return d;
+}
+
+static void test_apply(void)
+{
+    for (int r = 0; r < ARRAY_SIZE(rops); r++) {
+        for (int off = 0; off < 8; off++) {
+            for (int len = 0; len <= MAX_LEN; len++) {
+                uint8_t value = test_rand();
+
+                _fill();
+                for (int i = 0; i < len; i++) {
+                    ref[off + i] = _rop(ref[off + i], value, rops[r]);
+                }
+                adafruit_gfx_rop_apply(&dst[off], len, rops[r], value);
+                zassert_mem_equal(dst, ref, BUF_SIZE, "rop %d off %d len %d", r, off, len);
+            }
+        }
+    }
+}
+
+static void test_compose(void)
+{
+    for (int r = 0; r < ARRAY_SIZE(rops); r++) {
+        for (int off = 0; off < 8; off++) {
+            for (int soff = 0; soff < 8; soff++) {
+                for (int len = 0; len <= MAX_LEN; len++) {
+                    _fill();
+                    for (int i = 0; i < len; i++) {
+                        ref[off + i] = _rop(ref[off + i], src[soff + i], rops[r]);
+                    }
+                    adafruit_gfx_rop_compose(&dst[off], &src[soff], len, rops[r]);
+                    zassert_mem_equal(dst, ref, BUF_SIZE, "rop %d off %d/%d len %d",
+                                      r, off, soff, len);
+                }
+            }
+        }
+    }
+}
+
+static void test_blend(void)
+{
+    for (int off = 0; off < 8; off++) {
+        for (int soff = 0; soff < 8; soff++) {
+            for (int len = 0; len <= MAX_LEN; len++) {
+                uint8_t mask = test_rand();
+
+                _fill();
+                for (int i = 0; i < len; i++) {
+                    ref[off + i] = (ref[off + i] & ~mask) | (src[soff + i] & mask);
+                }
+                adafruit_gfx_rop_blend(&dst[off], &src[soff], len, mask);
+                zassert_mem_equal(dst, ref, BUF_SIZE, "off %d/%d len %d", off, soff, len);
+            }
+        }
+    }
+}
+
+static void test_shift(void)
+{
+    for (int n = 1; n < 8; n++) {
+        for (int off = 0; off < 8; off++) {
+            for (int len = 0; len <= MAX_LEN; len++) {
+                /* Up, with and without the page row below */
+                _fill();
+                for (int i = 0; i < len; i++) {
+                    ref[off + i] = (ref[off + i] >> n) | (uint8_t)(src[off + i] << (8 - n));
+                }
+                adafruit_gfx_rop_shift_up(&dst[off], &src[off], len, n);
+                zassert_mem_equal(dst, ref, BUF_SIZE, "up %d off %d len %d", n, off, len);
+
+                _fill();
+                for (int i = 0; i < len; i++) {
+                    ref[off + i] >>= n;
+                }
+                adafruit_gfx_rop_shift_up(&dst[off], NULL, len, n);
+                zassert_mem_equal(dst, ref, BUF_SIZE, "up %d off %d len %d", n, off, len);
+
+                /* Down, with and without the page row above */
+                _fill();
+                for (int i = 0; i < len; i++) {
+                    ref[off + i] = (uint8_t)(ref[off + i] << n) | (src[off + i] >> (8 - n));
+                }
+                adafruit_gfx_rop_shift_down(&dst[off], &src[off], len, n);
+                zassert_mem_equal(dst, ref, BUF_SIZE, "down %d off %d len %d", n, off, len);
+
+                _fill();
+                for (int i = 0; i < len; i++) {
+                    ref[off + i] <<= n;
+                }
+                adafruit_gfx_rop_shift_down(&dst[off], NULL, len, n);
+                zassert_mem_equal(dst, ref, BUF_SIZE, "down %d off %d len %d", n, off, len);
+            }
+        }
+    }
+}
+
+static void test_transpose8(void)
+{
+    uint8_t in[8];
+    uint8_t out[8];
+
+    for (int n = 0; n < 200; n++) {
+        for (int i = 0; i < 8; i++) {
+            in[i] = test_rand();
+        }
+        adafruit_gfx_rop_transpose8(in, out);
+
+        for (int i = 0; i < 8; i++) {
+            for (int j = 0; j < 8; j++) {
+                zassert_equal((out[i] >> j) & 1, (in[j] >> i) & 1, "bit %d of out[%d]", j, i);
+            }
+        }
+    }
+}
+
+void test_main(void)
+{
+    ztest_test_suite(rop,
+                     ztest_unit_test(test_apply),
+                     ztest_unit_test(test_compose),
+                     ztest_unit_test(test_blend),
+                     ztest_unit_test(test_shift),
+                     ztest_unit_test(test_transpose8));
+    ztest_run_test_suite(rop);
+}
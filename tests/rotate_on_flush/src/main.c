@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "ssd1306_emul.h"
+#include "test_util.h"
+
+/*
+ * At rotations 1 and 3 the draw buffer holds the screen unrotated and the
+ * frame is turned with 8x8 transposes on its way to the panel.  The panel
+ * is checked pixel by pixel against a model of the logical screen.
+ */
+static void _check_panel(int r)
+{
+    int bad = panel_model_diff();
+
+    zassert_equal(bad, 0, "rotation %d: %d pixels differ", r, bad);
+}
+
+static void test_initialize(void)
+{
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+}
+
+static void test_full_frame(void)
+{
+    for (int r = 0; r < 4; r++) {
+        adafruit_gfx_setRotation(r);
+        int width = adafruit_gfx_width();
+        int height = adafruit_gfx_height();
+
+        panel_model_reset();
+        adafruit_gfx_clearDisplay();
+
+        adafruit_gfx_fillRect(3, 5, 40, 21, WHITE);
+        panel_model_rect(3, 5, 40, 21, WHITE);
+        adafruit_gfx_fillRect(10, 2, 7, height - 4, INVERSE);
+        panel_model_rect(10, 2, 7, height - 4, INVERSE);
+        for (int i = 0; i < 300; i++) {
+            int x = test_rand() % width;
+            int y = test_rand() % height;
+
+            adafruit_gfx_drawPixel(x, y, INVERSE);
+            panel_model_pixel(x, y, INVERSE);
+        }
+
+        ssd1306_emul_clear();
+        zassert_equal(adafruit_gfx_display(), 0, "display failed");
+        _check_panel(r);
+    }
+}
+
+static void test_region(void)
+{
+    for (int r = 0; r < 4; r++) {
+        adafruit_gfx_setRotation(r);
+        int width = adafruit_gfx_width();
+        int height = adafruit_gfx_height();
+
+        panel_model_reset();
+        adafruit_gfx_clearDisplay();
+        zassert_equal(adafruit_gfx_display(), 0, "display failed");
+
+        for (int i = 0; i < 20; i++) {
+            int x = test_rand() % width;
+            int y = test_rand() % height;
+            int w = test_rand() % 30 + 1;
+            int h = test_rand() % 30 + 1;
+
+            w = MIN(w, width - x);
+            h = MIN(h, height - y);
+
+            adafruit_gfx_fillRect(x, y, w, h, INVERSE);
+            panel_model_rect(x, y, w, h, INVERSE);
+            zassert_equal(adafruit_gfx_displayRegion(x, y, w, h), 0, "displayRegion failed");
+        }
+        _check_panel(r);
+    }
+}
+
+void test_main(void)
+{
+    ztest_test_suite(rotate_on_flush,
+                     ztest_unit_test(test_initialize),
+                     ztest_unit_test(test_full_frame),
+                     ztest_unit_test(test_region));
+    ztest_run_test_suite(rotate_on_flush);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "ssd1306_emul.h"
+#include "test_util.h"
+
+/*
+ * Layers are composed at the same RAM address as the base buffer, so a
+ * scroll has to move all of them whichever one is being drawn into.  The
+ * base buffer and the two layers (OR, then XOR) are each modelled
+ * separately, composed, and checked against the panel as it is shown
+ * after the start line.
+ */
+#define PLANES      3
+#define PLANE_SIZE  (SSD1306_EMUL_WIDTH * SSD1306_EMUL_PAGES * 8)
+
+static bool planes[PLANES][PLANE_SIZE];
+static int width;
+static int height;
+
+static void _reset(void)
+{
+    width = adafruit_gfx_width();
+    height = adafruit_gfx_height();
+    memset(planes, 0, sizeof(planes));
+
+    for (int i = 0; i < PLANES; i++) {
+        adafruit_gfx_setLayer(i);
+        adafruit_gfx_clearDisplay();
+    }
+    adafruit_gfx_setLayer(GFX_LAYER_BASE);
+}
+
+/* Fill a rectangle in one plane and in the matching library buffer */
+static void _fill(int plane, int x, int y, int w, int h)
+{
+    adafruit_gfx_setLayer(plane);
+    adafruit_gfx_fillRect(x, y, w, h, WHITE);
+
+    for (int j = y; j < y + h; j++) {
+        for (int i = x; i < x + w; i++) {
+            planes[plane][i + j * width] = true;
+        }
+    }
+}
+
+/* Move the rectangle up by dy rows in every plane, clearing the rows exposed */
+static void _scroll_planes(int x, int y, int w, int h, int dy)
+{
+    for (int p = 0; p < PLANES; p++) {
+        for (int n = 0; n < h; n++) {
+            int j = (dy > 0) ? y + n : y + h - 1 - n;
+            int src = j + dy;
+
+            for (int i = x; i < x + w; i++) {
+                bool v = (src >= y && src < y + h) && planes[p][i + src * width];
+                planes[p][i + j * width] = v;
+            }
+        }
+    }
+}
+
+static void _fill_planes(void)
+{
+    _fill(0, 4, 3, 50, 20);
+    _fill(0, 30, height - 9, 20, 9);
+    _fill(1, 40, 10, 20, 30);
+    _fill(1, 0, 0, width, 2);
+    _fill(2, 20, 15, 40, 6);
+    _fill(2, width - 12, height - 30, 12, 30);
+}
+
+static void _check_panel(const char *what)
+{
+    panel_model_reset();
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int i = x + y * width;
+            bool on = (planes[0][i] || planes[1][i]) != planes[2][i];
+
+            panel_model_pixel(x, y, on ? WHITE : BLACK);
+        }
+    }
+
+    ssd1306_emul_clear();
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+
+    int bad = panel_model_diff();
+    zassert_equal(bad, 0, "%s: %d pixels differ", what, bad);
+}
+
+static void test_initialize(void)
+{
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+    zassert_equal(adafruit_gfx_setLayerMode(1, GFX_LAYER_OR), 0, "setLayerMode failed");
+    zassert_equal(adafruit_gfx_setLayerMode(2, GFX_LAYER_XOR), 0, "setLayerMode failed");
+    zassert_equal(adafruit_gfx_showLayer(1, true), 0, "showLayer failed");
+    zassert_equal(adafruit_gfx_showLayer(2, true), 0, "showLayer failed");
+}
+
+static void test_scroll_vertical(void)
+{
+    /* Adds up to nothing, so the start line ends where it began */
+    static const int steps[] = { 5, 11, -3, -13 };
+
+    for (int r = 0; r < 4; r += 2) {
+        adafruit_gfx_setRotation(r);
+        _reset();
+        _fill_planes();
+        _check_panel("before scrolling");
+
+        for (int s = 0; s < ARRAY_SIZE(steps); s++) {
+            /* Scroll with the top layer as the drawing target */
+            adafruit_gfx_setLayer(2);
+            zassert_equal(adafruit_gfx_scrollVertical(steps[s]), 0, "scrollVertical failed");
+            zassert_equal(adafruit_gfx_getLayer(), 2, "drawing target changed");
+            _scroll_planes(0, 0, width, height, steps[s]);
+            _check_panel("scrollVertical");
+        }
+        zassert_equal(ssd1306_emul_start_line(), 0, "start line not back at 0");
+    }
+}
+
+static void test_scroll_region(void)
+{
+    for (int r = 0; r < 4; r++) {
+        adafruit_gfx_setRotation(r);
+        _reset();
+        _fill_planes();
+        _check_panel("before scrolling");
+
+        for (int i = 0; i < 12; i++) {
+            int x = test_rand() % (width - 8);
+            int y = test_rand() % (height - 8);
+            int w = test_rand() % (width - x) + 1;
+            int h = test_rand() % (height - y) + 1;
+            int dy = (int)(test_rand() % 21) - 10;
+
+            adafruit_gfx_setLayer(i % PLANES);
+            zassert_equal(adafruit_gfx_scrollRegion(x, y, w, h, dy), 0, "scrollRegion failed");
+            zassert_equal(adafruit_gfx_getLayer(), i % PLANES, "drawing target changed");
+            _scroll_planes(x, y, w, h, dy);
+            _check_panel("scrollRegion");
+        }
+    }
+}
+
+void test_main(void)
+{
+    ztest_test_suite(scroll_layers,
+                     ztest_unit_test(test_initialize),
+                     ztest_unit_test(test_scroll_vertical),
+                     ztest_unit_test(test_scroll_region));
+    ztest_run_test_suite(scroll_layers);
+}
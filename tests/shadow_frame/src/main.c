@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "adafruit-gfx-cache.h"
+#include "ssd1306_emul.h"
+#include "test_util.h"
+
+/*
+ * With the shadow frame adafruit_gfx_display() compares the draw buffer
+ * against a copy of what the panel holds and only sends the bytes that
+ * changed.  Bytes are written straight into the draw buffer through the
+ * cache, and the bus counters show which windows went out.  Each window
+ * costs one 6 byte window command.
+ */
+#define PANEL_BYTES     (SSD1306_EMUL_WIDTH * SSD1306_EMUL_PAGES)
+#define WINDOW_CMD      6
+#define MERGE_GAP       CONFIG_ADAFRUIT_SSD1306_SHADOW_MERGE_GAP
+
+/* What the panel's RAM should hold */
+static uint8_t ram[PANEL_BYTES];
+
+static void _poke(int col, int page, uint8_t value)
+{
+    struct adafruit_gfx_cache_t *cache;
+    uint8_t *addr;
+
+    adafruit_gfx_lock();
+    cache = adafruit_gfx_getCache();
+    zassert_not_null(cache, "no cache");
+    zassert_equal(adafruit_gfx_cache_get_pixel_addr(cache, col, page << 3, &addr), 0,
+                  "get_pixel_addr failed");
+    *addr = value;
+    adafruit_gfx_cache_set_dirty(cache, true);
+    adafruit_gfx_unlock();
+
+    ram[col + page * SSD1306_EMUL_WIDTH] = value;
+}
+
+/* Send a frame, expecting data_bytes of data in the given number of windows */
+static void _frame(uint32_t data_bytes, uint32_t windows)
+{
+    struct adafruit_gfx_bus_stats_t stats;
+
+    adafruit_gfx_bus_stats(NULL, true);
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+    adafruit_gfx_bus_stats(&stats, true);
+
+    zassert_equal(stats.data_bytes, data_bytes, "%u data bytes sent", stats.data_bytes);
+    zassert_equal(stats.command_bytes, windows * WINDOW_CMD, "%u command bytes sent",
+                  stats.command_bytes);
+    zassert_equal(stats.frames, windows ? 1 : 0, "%u frames counted", stats.frames);
+}
+
+static void _check_ram(void)
+{
+    zassert_mem_equal(ssd1306_emul_gddram(), ram, PANEL_BYTES, "panel RAM differs");
+}
+
+static void test_initialize(void)
+{
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+
+    /* The first frame after the logo goes out whole */
+    adafruit_gfx_clearDisplay();
+    memset(ram, 0, sizeof(ram));
+    _frame(PANEL_BYTES, 1);
+    _check_ram();
+}
+
+static void test_unchanged(void)
+{
+    _frame(0, 0);
+
+    /* Writing back what is already there isn't a change either */
+    _poke(5, 3, ram[5 + 3 * SSD1306_EMUL_WIDTH]);
+    _frame(0, 0);
+}
+
+static void test_direct_write(void)
+{
+    _poke(10, 2, 0x5A);
+    _poke(11, 2, 0xFF);
+    _poke(12, 2, 0x01);
+    _frame(3, 1);
+    _check_ram();
+
+    _poke(127, 7, 0x80);
+    _frame(1, 1);
+    _check_ram();
+}
+
+static void test_merge_gap(void)
+{
+    /* MERGE_GAP unchanged bytes apart: one window, the gap is resent */
+    _poke(20, 4, 0x11);
+    _poke(20 + MERGE_GAP + 1, 4, 0x22);
+    _frame(MERGE_GAP + 2, 1);
+    _check_ram();
+
+    /* One more apart: two windows */
+    _poke(40, 4, 0x33);
+    _poke(40 + MERGE_GAP + 2, 4, 0x44);
+    _frame(2, 2);
+    _check_ram();
+
+    /* The same columns on consecutive pages grow one window */
+    for (int page = 3; page <= 5; page++) {
+        _poke(60, page, 0x0F);
+        _poke(61, page, 0xF0);
+    }
+    _frame(6, 1);
+    _check_ram();
+}
+
+#ifdef CONFIG_ADAFRUIT_SSD1306_ROTATE_ON_FLUSH
+/*
+ * At rotation 1 the draw buffer is folded and compared a band of columns
+ * at a time as it is turned, each band sending the box around its changes.
+ * Logical (x, y) is panel column 127 - y, row x.
+ */
+static void test_folded(void)
+{
+    adafruit_gfx_setRotation(1);
+    panel_model_reset();
+    adafruit_gfx_clearDisplay();
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+    _frame(0, 0);
+
+    /* Columns 120-122 of page 0 */
+    adafruit_gfx_fillRect(5, 5, 3, 3, WHITE);
+    panel_model_rect(5, 5, 3, 3, WHITE);
+    _frame(3, 1);
+    zassert_equal(panel_model_diff(), 0, "panel differs");
+
+    /* Column 87 of pages 0 and 1 */
+    adafruit_gfx_fillRect(6, 40, 4, 1, WHITE);
+    panel_model_rect(6, 40, 4, 1, WHITE);
+    _frame(2, 1);
+    zassert_equal(panel_model_diff(), 0, "panel differs");
+
+    /* Columns 100 and 103 at the top and bottom of one band: the box */
+    adafruit_gfx_drawPixel(0, 27, WHITE);
+    panel_model_pixel(0, 27, WHITE);
+    adafruit_gfx_drawPixel(63, 24, WHITE);
+    panel_model_pixel(63, 24, WHITE);
+    _frame(4 * SSD1306_EMUL_PAGES, 1);
+    zassert_equal(panel_model_diff(), 0, "panel differs");
+
+    _frame(0, 0);
+    adafruit_gfx_setRotation(0);
+}
+#else
+static void test_folded(void)
+{
+    ztest_test_skip();
+}
+#endif
+
+void test_main(void)
+{
+    ztest_test_suite(shadow_frame,
+                     ztest_unit_test(test_initialize),
+                     ztest_unit_test(test_unchanged),
+                     ztest_unit_test(test_direct_write),
+                     ztest_unit_test(test_merge_gap),
+                     ztest_unit_test(test_folded));
+    ztest_run_test_suite(shadow_frame);
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2020 Gavin Hurlbut
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <ztest.h>
+#include <string.h>
+
+#include "adafruit-gfx-api.h"
+#include "ssd1306_emul.h"
+#include "test_util.h"
+
+/*
+ * In strip mode draw calls are recorded into a display list and replayed
+ * into a single page row buffer for each page as the frame is sent.  The
+ * same screen is drawn at every rotation and checked against a model of
+ * the logical screen, with the clip applied by the model.
+ */
+static int clip_x0, clip_y0, clip_x1, clip_y1;
+
+static void _clip(int x, int y, int w, int h)
+{
+    adafruit_gfx_setClipRect(x, y, w, h);
+    clip_x0 = MAX(x, 0);
+    clip_y0 = MAX(y, 0);
+    clip_x1 = MIN(x + w, adafruit_gfx_width());
+    clip_y1 = MIN(y + h, adafruit_gfx_height());
+}
+
+static void _unclip(void)
+{
+    adafruit_gfx_resetClip();
+    _clip(0, 0, adafruit_gfx_width(), adafruit_gfx_height());
+}
+
+static void _model_pixel(int x, int y, int color)
+{
+    if (x >= clip_x0 && x < clip_x1 && y >= clip_y0 && y < clip_y1) {
+        panel_model_pixel(x, y, color);
+    }
+}
+
+static void _model_rect(int x, int y, int w, int h, int color)
+{
+    for (int j = y; j < y + h; j++) {
+        for (int i = x; i < x + w; i++) {
+            _model_pixel(i, j, color);
+        }
+    }
+}
+
+static void _start(int r)
+{
+    adafruit_gfx_setRotation(r);
+    panel_model_reset();
+    adafruit_gfx_clearDisplay();
+    _unclip();
+}
+
+static void _check_panel(const char *what, int r)
+{
+    ssd1306_emul_clear();
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+
+    int bad = panel_model_diff();
+    zassert_equal(bad, 0, "%s, rotation %d: %d pixels differ", what, r, bad);
+}
+
+static void test_initialize(void)
+{
+    zassert_equal(adafruit_gfx_initialize(), 0, "initialize failed");
+    zassert_equal(adafruit_gfx_display(), 0, "display failed");
+}
+
+static void test_rotations(void)
+{
+    for (int r = 0; r < 4; r++) {
+        int width;
+        int height;
+
+        _start(r);
+        width = adafruit_gfx_width();
+        height = adafruit_gfx_height();
+
+        adafruit_gfx_fillRect(3, 5, 40, 21, WHITE);
+        _model_rect(3, 5, 40, 21, WHITE);
+        adafruit_gfx_fillRect(10, 2, 7, height - 4, INVERSE);
+        _model_rect(10, 2, 7, height - 4, INVERSE);
+        adafruit_gfx_drawFastHLine(-5, 12, width, INVERSE);
+        _model_rect(-5, 12, width, 1, INVERSE);
+
+        /* Everything from here to _unclip() lands inside the clip only */
+        _clip(20, 9, 30, 30);
+        adafruit_gfx_fillRect(0, 0, width, height, INVERSE);
+        _model_rect(0, 0, width, height, INVERSE);
+        adafruit_gfx_drawFastVLine(25, -3, height + 6, INVERSE);
+        _model_rect(25, -3, 1, height + 6, INVERSE);
+        adafruit_gfx_fillRect(30, 15, 8, 8, BLACK);
+        _model_rect(30, 15, 8, 8, BLACK);
+        _unclip();
+
+        for (int i = 0; i < 30; i++) {
+            int x = test_rand() % width;
+            int y = test_rand() % height;
+
+            adafruit_gfx_drawPixel(x, y, INVERSE);
+            _model_pixel(x, y, INVERSE);
+        }
+        adafruit_gfx_drawFastVLine(width - 1, 0, height, WHITE);
+        _model_rect(width - 1, 0, 1, height, WHITE);
+
+        _check_panel("screen", r);
+    }
+}
+
+/* A rotation change part way through the list is replayed in order */
+static void test_rotation_change(void)
+{
+    _start(0);
+    adafruit_gfx_fillRect(0, 0, 64, 32, WHITE);
+    _model_rect(0, 0, 64, 32, WHITE);
+
+    /* (x, y, w, h) at rotation 1 is (128 - y - h, x, h, w) at rotation 0 */
+    adafruit_gfx_setRotation(1);
+    adafruit_gfx_fillRect(10, 20, 30, 50, INVERSE);
+    _model_rect(128 - 20 - 50, 10, 50, 30, INVERSE);
+
+    adafruit_gfx_setRotation(0);
+    adafruit_gfx_drawFastHLine(0, 40, 128, INVERSE);
+    _model_rect(0, 40, 128, 1, INVERSE);
+
+    _check_panel("rotation change", 0);
+}
+
+/* Back to back state changes share one entry, so they never fill the list */
+static void test_state_coalescing(void)
+{
+    _start(0);
+    for (int i = 0; i < 200; i++) {
+        _clip(i % 40, i % 20, 50, 30);
+    }
+    adafruit_gfx_fillRect(0, 0, 128, 64, WHITE);
+    _model_rect(0, 0, 128, 64, WHITE);
+    _unclip();
+
+    _check_panel("coalesced clips", 0);
+}
+
+static void test_overflow(void)
+{
+    static int16_t xs[200];
+    static int16_t ys[200];
+    int lit = 0;
+
+    _start(0);
+    for (int i = 0; i < ARRAY_SIZE(xs); i++) {
+        xs[i] = i % 128;
+        ys[i] = (i / 128) * 8 + i % 7;
+        adafruit_gfx_drawPixel(xs[i], ys[i], WHITE);
+        panel_model_pixel(xs[i], ys[i], WHITE);
+    }
+
+    /* The calls that fit are still drawn, the rest are dropped */
+    ssd1306_emul_clear();
+    zassert_equal(adafruit_gfx_display(), -ENOMEM, "overflow not reported");
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 128; x++) {
+            bool on = ssd1306_emul_shown(x, y);
+
+            zassert_true(!on || panel_model_get(x, y), "stray pixel at %d,%d", x, y);
+            lit += on;
+        }
+    }
+    zassert_true(ssd1306_emul_shown(xs[0], ys[0]), "first call dropped");
+    zassert_true(lit > 0 && lit < ARRAY_SIZE(xs), "%d pixels drawn", lit);
+
+    /* Still reported until the list starts over */
+    zassert_equal(adafruit_gfx_display(), -ENOMEM, "overflow forgotten");
+    _start(0);
+    adafruit_gfx_fillRect(8, 8, 16, 16, WHITE);
+    _model_rect(8, 8, 16, 16, WHITE);
+    _check_panel("after overflow", 0);
+}
+
+void test_main(void)
+{
+    ztest_test_suite(strip_mode,
+                     ztest_unit_test(test_initialize),
+                     ztest_unit_test(test_rotations),
+                     ztest_unit_test(test_rotation_change),
+                     ztest_unit_test(test_state_coalescing),
+                     ztest_unit_test(test_overflow));
+    ztest_run_test_suite(strip_mode);
+}